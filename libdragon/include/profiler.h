@@ -0,0 +1,43 @@
+/**
+ * @file profiler.h
+ * @brief Sampling CPU profiler
+ * @ingroup profiler
+ */
+#ifndef __LIBDRAGON_PROFILER_H
+#define __LIBDRAGON_PROFILER_H
+
+#include <stdint.h>
+
+/**
+ * @addtogroup profiler
+ * @{
+ */
+
+/** @brief Size of a histogram bucket, as a power of two (8 bytes: two instructions) */
+#define PROFILER_BUCKET_SHIFT   3
+
+/** @brief Maximum number of distinct (PC, return address) pairs recorded */
+#define PROFILER_MAX_EDGES      1024
+
+/** @} */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* start sampling the interrupted PC at the given frequency (in Hz) */
+void profiler_start(int frequency);
+/* stop sampling, keeping the collected samples */
+void profiler_stop(void);
+/* clear all the collected samples */
+void profiler_reset(void);
+/* dump the collected samples to the debug log (no-op with NDEBUG) */
+void profiler_dump(void);
+/* stop sampling and free the sample buffers */
+void profiler_close(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
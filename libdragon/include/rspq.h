@@ -193,6 +193,18 @@ typedef struct rspq_block_s rspq_block_t;
  */
 typedef int rspq_syncpoint_t;
 
+/**
+ * @brief Callback invoked when a syncpoint is reached by RSP
+ * 
+ * See #rspq_syncpoint_new_cb.
+ * 
+ * @param arg  The argument given to #rspq_syncpoint_new_cb
+ */
+typedef void (*rspq_syncpoint_callback_t)(void *arg);
+
+/** @brief Maximum number of syncpoint callbacks waiting to be run at the same time */
+#define RSPQ_MAX_SYNCPOINT_CALLBACKS    32
+
 /**
  * @brief Initialize the RSPQ library.
  * 
@@ -205,6 +217,122 @@ typedef int rspq_syncpoint_t;
  */
 void rspq_init(void);
 
+/**
+ * @brief Configuration of the RSPQ library (see #rspq_init_config)
+ */
+typedef struct {
+    int lowpri_buffer_size;             ///< Size of each of the two lowpri buffers, in 32-bit words (0: default)
+    int highpri_buffer_size;            ///< Size of each of the two highpri buffers, in 32-bit words (0: default)
+} rspq_config_t;
+
+/**
+ * @brief Initialize the RSPQ library with custom queue sizes.
+ * 
+ * This works like #rspq_init, but allows to configure the size of the RDRAM
+ * buffers used by the lowpri and highpri queues. Larger buffers let the CPU
+ * run further ahead of the RSP before it has to wait for a buffer to be
+ * free again (see #rspq_stats_t to measure how often this happens).
+ * 
+ * Since higher-level libraries call #rspq_init, this must be called before
+ * initializing them. If the library was already initialized, this function
+ * does nothing.
+ * 
+ * @param[in]  config   Configuration, or NULL to use the default sizes
+ *                      (RSPQ_DRAM_LOWPRI_BUFFER_SIZE and
+ *                      RSPQ_DRAM_HIGHPRI_BUFFER_SIZE)
+ * 
+ * @note The size of the DMEM buffer (RSPQ_DMEM_BUFFER_SIZE) is part of the
+ *       DMEM layout shared by all overlays, so it cannot be changed at runtime.
+ */
+void rspq_init_config(const rspq_config_t *config);
+
+/**
+ * @brief Statistics about the RSP queue (see #rspq_stats_get)
+ * 
+ * These counters help sizing the queue buffers: if the CPU often stalls
+ * waiting for a free buffer, the buffers are too small for the workload; if
+ * the RSP often goes idle, the CPU is not producing commands fast enough.
+ */
+typedef struct {
+    uint32_t buffer_switches;           ///< Number of full buffers (lowpri and highpri)
+    uint32_t buffer_stalls;             ///< Number of buffer switches that waited for the RSP
+    uint64_t buffer_stall_ticks;        ///< Total time spent waiting for a free buffer (in ticks, see #TICKS_READ)
+    uint32_t rsp_idle;                  ///< Number of flushes that woke up an idle RSP
+} rspq_stats_t;
+
+/**
+ * @brief Read the RSP queue statistics collected since #rspq_init or
+ *        #rspq_stats_reset.
+ * 
+ * @param[out] stats    Statistics
+ */
+void rspq_stats_get(rspq_stats_t *stats);
+
+/**
+ * @brief Reset the RSP queue statistics.
+ */
+void rspq_stats_reset(void);
+
+/** @brief Number of overlay slots reported by #rspq_profile_get */
+#define RSPQ_PROFILE_MAX_OVERLAYS       8
+
+/**
+ * @brief RSP time profile of an overlay (see #rspq_profile_t)
+ */
+typedef struct {
+    rsp_ucode_t *ucode;                 ///< Overlay (NULL for the builtin commands)
+    uint64_t rcp_cycles;                ///< RCP cycles spent running the commands of the overlay, including its loads
+    uint64_t commands;                  ///< Number of commands run
+    uint32_t loads;                     ///< Number of times the overlay was loaded into IMEM/DMEM
+    uint32_t saves;                     ///< Number of times the overlay state was saved to RDRAM
+} rspq_profile_overlay_t;
+
+/**
+ * @brief RSP time profile of the queue (see #rspq_profile_get)
+ * 
+ * Slot 0 holds the builtin commands of the queue engine (jumps, DMAs,
+ * syncpoints, etc.). It also includes the time spent by the RSP idle waiting
+ * for new commands. Other slots are the registered overlays, in registration
+ * order; empty slots have a NULL ucode.
+ * 
+ * The RSP keeps track of the biggest overlay loaded in IMEM since its last
+ * full load (the resident one): when the queue switches back to it, only the
+ * start of its code that smaller overlays overwrote is loaded again. These
+ * loads are counted in the loads of the overlay, and also in resident_loads.
+ */
+typedef struct {
+    rspq_profile_overlay_t overlays[RSPQ_PROFILE_MAX_OVERLAYS];     ///< Profile of each overlay slot
+    uint64_t resident_loads;            ///< Number of loads of the overlay resident in IMEM
+    uint64_t resident_bytes_saved;      ///< Bytes of code that resident loads did not transfer
+} rspq_profile_t;
+
+/**
+ * @brief Read the RSP time profile collected since #rspq_init or
+ *        #rspq_profile_reset.
+ * 
+ * This requires libdragon and all overlays to be built with RSPQ_PROFILE
+ * set to 1 (see rspq_constants.h). In these builds, the RSP queue engine
+ * measures the time of each command with the DP_CLOCK register and charges
+ * it to the overlay of the command. The counters are kept in DMEM, so this
+ * function waits for the RSP to process the queue, and then fetches and
+ * clears them with a highpri sequence: it cannot be called from highpri mode
+ * or while recording a block.
+ * 
+ * @note DP_CLOCK is a 24-bit counter, so a single command (or a single idle
+ *       period of the RSP) longer than about 0.27 seconds is measured modulo
+ *       that time.
+ * 
+ * @param[out] profile  Collected profile
+ */
+void rspq_profile_get(rspq_profile_t *profile);
+
+/**
+ * @brief Reset the RSP time profile.
+ * 
+ * Like #rspq_profile_get, this waits for the RSP to process the queue.
+ */
+void rspq_profile_reset(void);
+
 /**
  * @brief Shut down the RSPQ library.
  * 
@@ -509,6 +637,46 @@ inline void rspq_write_end(rspq_write_t *w) {
     w->pointer = 0;
 }
 
+/**
+ * @brief Reserve space in the RSP queue for a command, to be filled directly.
+ * 
+ * This function is an alternative to #rspq_write_begin + #rspq_write_arg,
+ * for commands that carry bulk data (eg: vertices or matrices). It reserves
+ * @p size contiguous words in the queue, switching buffer if needed, and
+ * returns a write cursor whose `pointer` field points to the words after
+ * the first one. The caller fills the size-1 words through the pointer
+ * (for instance with a copy loop), and then calls #rspq_write_end, which
+ * writes the first word last, so that the RSP never sees a partial command.
+ * 
+ * Compared to #rspq_write_arg, there is no per-word bookkeeping, and a
+ * single bounds check covers the whole command.
+ * 
+ * @code{.c}
+ *      rspq_write_t w = rspq_write_reserve(gfx_overlay_id, CMD_LOAD_MTX, 0, 17);
+ *      for (int i=0; i<16; i++)
+ *          w.pointer[i] = mtx[i];
+ *      rspq_write_end(&w);
+ * @endcode
+ * 
+ * @param      ovl_id    The overlay ID of the command to enqueue, as returned
+ *                       by #rspq_overlay_register.
+ * @param      cmd_id    Index of the command to call, within the overlay.
+ * @param      arg0      Argument in the first word of the command (24 bits;
+ *                       see #rspq_write)
+ * @param      size      The size of the command in 32-bit words, including
+ *                       the first word (at most #RSPQ_MAX_COMMAND_SIZE)
+ * @returns              A write cursor, that must be passed to #rspq_write_end
+ * 
+ * @see #rspq_write_begin
+ * @see #rspq_write_end
+ */
+inline rspq_write_t rspq_write_reserve(uint32_t ovl_id, uint32_t cmd_id, uint32_t arg0, int size) {
+    rspq_write_t w = rspq_write_begin(ovl_id, cmd_id, size);
+    w.first_word |= arg0;
+    w.is_first = 0;
+    return w;
+}
+
 /**
  * @brief Make sure that RSP starts executing up to the last written command.
  * 
@@ -604,6 +772,31 @@ void rspq_flush(void);
  */
 rspq_syncpoint_t rspq_syncpoint_new(void);
 
+/**
+ * @brief Create a syncpoint in the queue that runs a callback when reached.
+ * 
+ * This function works like #rspq_syncpoint_new, and additionally registers
+ * a callback that is invoked as soon as the RSP reaches the syncpoint. This
+ * allows the CPU to keep doing other work and be notified when the RSP is
+ * done with the data, instead of blocking in #rspq_syncpoint_wait.
+ * 
+ * The callback is invoked by the SP interrupt handler, so it runs with
+ * interrupts disabled: it must be short and it cannot wait for other
+ * syncpoints. Callbacks run in the same order their syncpoints were created.
+ * 
+ * At most #RSPQ_MAX_SYNCPOINT_CALLBACKS callbacks can be pending at the same
+ * time. If the limit is reached, this function waits for the oldest one to
+ * be run. Callbacks still pending when #rspq_close is called are discarded.
+ * 
+ * @param[in]  cb   Callback to invoke
+ * @param[in]  arg  Argument passed to the callback
+ * 
+ * @return     ID of the just-created syncpoint.
+ * 
+ * @see #rspq_syncpoint_new
+ */
+rspq_syncpoint_t rspq_syncpoint_new_cb(rspq_syncpoint_callback_t cb, void *arg);
+
 /**
  * @brief Check whether a syncpoint was reached by RSP or not.
  * 
@@ -626,6 +819,11 @@ bool rspq_syncpoint_check(rspq_syncpoint_t sync_id);
  * If the syncpoint was already called at the moment of call, the function
  * exits immediately.
  * 
+ * Syncpoints are signaled by the SP interrupt, so while waiting the CPU only
+ * reads a counter from the data cache, and does not compete with the RSP for
+ * the bus. The RSP status is checked once per millisecond, to detect RSP
+ * crashes.
+ * 
  * @param[in]  sync_id  ID of the syncpoint to wait for
  * 
  * @see #rspq_syncpoint_t
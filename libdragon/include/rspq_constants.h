@@ -3,6 +3,13 @@
 
 #define RSPQ_DEBUG                     1
 
+/** Build the queue engine with per-overlay profiling (see rspq_profile_get).
+ *  libdragon and all overlays must be built with the same value. */
+#ifndef RSPQ_PROFILE
+#define RSPQ_PROFILE                   0
+#endif
+#define RSPQ_PROFILE_SLOT_SIZE         12      ///< Size of the profiling counters of an overlay in DMEM
+
 #define RSPQ_DRAM_LOWPRI_BUFFER_SIZE   0x200   ///< Size of each RSPQ RDRAM buffer for lowpri queue (in 32-bit words)
 #define RSPQ_DRAM_HIGHPRI_BUFFER_SIZE  0x80    ///< Size of each RSPQ RDRAM buffer for highpri queue (in 32-bit words)
 
@@ -0,0 +1,207 @@
+/**
+ * @file profiler.c
+ * @brief Sampling CPU profiler
+ * @ingroup profiler
+ */
+#include <malloc.h>
+#include <string.h>
+#include "libdragon.h"
+#include "profiler.h"
+
+/**
+ * @defgroup profiler Sampling CPU profiler
+ * @ingroup libdragon
+ * @brief Statistical profiler based on the timer interrupt.
+ *
+ * The profiler registers a continuous timer that, at the requested frequency,
+ * reads the program counter at which the CPU was interrupted (EPC) and
+ * increments the matching bucket of a histogram that covers the whole text
+ * segment. The return address register is recorded as well, together with
+ * the PC, so that a host tool can reconstruct the caller of leaf functions.
+ *
+ * Code should call #timer_init before #profiler_start. All memory is
+ * allocated by #profiler_start, so the sampling itself does not allocate.
+ * #profiler_dump prints the samples to the debug log (see #debugf), between
+ * the "@@PROFILE-BEGIN@@" and "@@PROFILE-END@@" markers. The n64prof host
+ * tool symbolizes a captured log against the ELF file into a flat profile
+ * and a caller/callee profile.
+ *
+ * The debug log, like #debugf itself, is compiled out when NDEBUG is
+ * defined. In such builds the samples are still collected, but
+ * #profiler_dump outputs nothing, so profiling requires a debug build.
+ *
+ * Since samples are taken under interrupt, time spent with interrupts
+ * disabled is attributed to the point where they are enabled again.
+ * @{
+ */
+
+/** @brief Start of the text segment (defined by the linker script) */
+extern char __text_start[];
+/** @brief End of the text segment (defined by the linker script) */
+extern char __text_end[];
+
+/**
+ * @brief Stack pointer of the current interrupt frame (see inthandler.S)
+ *
+ * The frame starts with 32 bytes reserved for the ABI, followed by a
+ * #reg_block_t with the interrupted context.
+ */
+extern uint32_t interrupt_exception_frame;
+
+/** @brief A (PC, return address) pair seen while sampling */
+typedef struct {
+    uint32_t pc;            ///< Bucket-aligned interrupted PC
+    uint32_t ra;            ///< Return address register at the same time
+    uint32_t count;         ///< Number of samples
+} profiler_edge_t;
+
+static timer_link_t *prof_timer;
+static int prof_frequency;
+static uint32_t *prof_hist;
+static int prof_hist_size;
+static profiler_edge_t *prof_edges;
+static uint32_t prof_samples;
+static uint32_t prof_outside;
+static uint32_t prof_dropped;
+
+/** @brief Record a (PC, return address) pair, with linear probing */
+static void profiler_add_edge(uint32_t pc, uint32_t ra)
+{
+    uint32_t h = (((pc >> PROFILER_BUCKET_SHIFT) ^ (ra >> 2)) * 2654435761u) % PROFILER_MAX_EDGES;
+
+    for (int i=0; i<8; i++) {
+        profiler_edge_t *e = &prof_edges[(h + i) % PROFILER_MAX_EDGES];
+        if (e->count && (e->pc != pc || e->ra != ra))
+            continue;
+        e->pc = pc;
+        e->ra = ra;
+        e->count++;
+        return;
+    }
+    prof_dropped++;
+}
+
+/** @brief Timer callback: sample the interrupted context */
+static void profiler_sample(int ovfl)
+{
+    reg_block_t *regs = (reg_block_t*)(interrupt_exception_frame + 32);
+    uint32_t pc = regs->epc;
+    uint32_t ra = regs->gpr[31];
+
+    prof_samples++;
+    if (pc < (uint32_t)__text_start || pc >= (uint32_t)__text_end) {
+        prof_outside++;
+        return;
+    }
+
+    uint32_t idx = (pc - (uint32_t)__text_start) >> PROFILER_BUCKET_SHIFT;
+    prof_hist[idx]++;
+    profiler_add_edge(pc & ~((1 << PROFILER_BUCKET_SHIFT) - 1), ra);
+}
+
+/**
+ * @brief Start sampling the interrupted PC
+ *
+ * The first call allocates the histogram: 4 bytes every
+ * (1 << #PROFILER_BUCKET_SHIFT) bytes of code, plus the table of edges.
+ * Samples accumulate across calls to #profiler_start and #profiler_stop,
+ * until #profiler_reset.
+ *
+ * @param[in] frequency
+ *            Number of samples per second
+ */
+void profiler_start(int frequency)
+{
+    assertf(frequency > 0 && frequency <= TICKS_PER_SECOND, "invalid profiler frequency: %d", frequency);
+
+    if (!prof_hist) {
+        prof_hist_size = ((__text_end - __text_start) >> PROFILER_BUCKET_SHIFT) + 1;
+        prof_hist = malloc(prof_hist_size * sizeof(uint32_t));
+        prof_edges = malloc(PROFILER_MAX_EDGES * sizeof(profiler_edge_t));
+        assertf(prof_hist && prof_edges, "not enough memory for the profiler");
+        profiler_reset();
+    }
+
+    profiler_stop();
+    prof_frequency = frequency;
+    prof_timer = new_timer(TICKS_PER_SECOND / frequency, TF_CONTINUOUS, profiler_sample);
+}
+
+/**
+ * @brief Stop sampling
+ *
+ * Collected samples are kept, and can be dumped with #profiler_dump.
+ */
+void profiler_stop(void)
+{
+    if (prof_timer) {
+        delete_timer(prof_timer);
+        prof_timer = NULL;
+    }
+}
+
+/**
+ * @brief Clear all the collected samples
+ */
+void profiler_reset(void)
+{
+    if (!prof_hist)
+        return;
+
+    disable_interrupts();
+    memset(prof_hist, 0, prof_hist_size * sizeof(uint32_t));
+    memset(prof_edges, 0, PROFILER_MAX_EDGES * sizeof(profiler_edge_t));
+    prof_samples = prof_outside = prof_dropped = 0;
+    enable_interrupts();
+}
+
+/**
+ * @brief Dump the collected samples to the debug log
+ *
+ * The dump is made of text lines:
+ *
+ *  - "P <frequency> <text start> <bucket shift> <samples> <outside> <dropped>":
+ *    sampling parameters. "outside" counts samples whose PC was outside of the
+ *    text segment, "dropped" samples whose edge did not fit in the table.
+ *  - "H <address> <count>": a non-empty histogram bucket.
+ *  - "E <pc> <ra> <count>": a (PC bucket, return address) pair.
+ *
+ * Sampling is paused during the dump. Nothing is output when NDEBUG is
+ * defined, as #debugf is compiled out.
+ */
+void profiler_dump(void)
+{
+    if (!prof_hist)
+        return;
+
+    bool running = prof_timer != NULL;
+    profiler_stop();
+
+    debugf("@@PROFILE-BEGIN@@\n");
+    debugf("P %d %08lx %d %lu %lu %lu\n", prof_frequency, (uint32_t)__text_start,
+        PROFILER_BUCKET_SHIFT, prof_samples, prof_outside, prof_dropped);
+    for (int i=0; i<prof_hist_size; i++)
+        if (prof_hist[i])
+            debugf("H %08lx %lu\n", (uint32_t)__text_start + (i << PROFILER_BUCKET_SHIFT), prof_hist[i]);
+    for (int i=0; i<PROFILER_MAX_EDGES; i++)
+        if (prof_edges[i].count)
+            debugf("E %08lx %08lx %lu\n", prof_edges[i].pc, prof_edges[i].ra, prof_edges[i].count);
+    debugf("@@PROFILE-END@@\n");
+
+    if (running)
+        profiler_start(prof_frequency);
+}
+
+/**
+ * @brief Stop sampling and free all the memory used by the profiler
+ */
+void profiler_close(void)
+{
+    profiler_stop();
+    free(prof_edges);
+    free(prof_hist);
+    prof_edges = NULL;
+    prof_hist = NULL;
+}
+
+/** @} */
@@ -61,7 +61,11 @@
  *    one, the RSP loads the new overlay into IMEM/DMEM. Before doing so, it
  *    also saves the current overlay's state back into RDRAM (this is a portion
  *    of DMEM specified by the overlay itself as "state", that is preserved
- *    across overlay switching).
+ *    across overlay switching). Since all overlays are linked at the same
+ *    IMEM address, the RSP also tracks the biggest overlay loaded since its
+ *    last full load (the "resident" one): switching back to it only reloads
+ *    the start of its code, that smaller overlays have overwritten in the
+ *    meantime. This makes alternating a big overlay with small ones cheaper.
  * 5. The RSP uses the command index to fetch the "command descriptor", a small
  *    structure that contains a pointer to the function in IMEM that executes
  *    the command, and the size of the command in word.
@@ -106,7 +110,8 @@
  * ## Buffer swapping
  * 
  * Internally, double buffering is used to implement the queue. The size of
- * each of the buffers is RSPQ_DRAM_LOWPRI_BUFFER_SIZE. When a buffer is full,
+ * each of the buffers is RSPQ_DRAM_LOWPRI_BUFFER_SIZE by default, and can be
+ * configured via #rspq_init_config. When a buffer is full,
  * the queue engine writes a RSPQ_CMD_JUMP command with the address of the
  * other buffer, to tell the RSP to jump there when it is done. 
  * 
@@ -178,6 +183,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <malloc.h>
+#include <stddef.h>
 
 /**
  * RSPQ internal commands (overlay 0)
@@ -383,6 +389,10 @@ typedef struct rsp_queue_s {
     uint32_t rspq_dram_highpri_addr;     ///< Address of the highpri queue  (special slot in the pointer stack)
     uint32_t rspq_dram_addr;             ///< Current RDRAM address being processed
     int16_t current_ovl;                 ///< Current overlay index
+    uint16_t padding;                    ///< Padding to align the resident overlay fields
+    uint32_t resident_code;              ///< RDRAM address of the code of the overlay resident in IMEM
+    uint16_t resident_code_size;         ///< Code size of the overlay resident in IMEM, minus one
+    uint16_t resident_clobbered;         ///< Bytes of the resident code overwritten by smaller overlays
 } __attribute__((aligned(16), packed)) rsp_queue_t;
 
 /**
@@ -447,9 +457,58 @@ static int rspq_syncpoints_genid;
 /** @brief ID of the last syncpoint reached by RSP. */
 static volatile int rspq_syncpoints_done;
 
+/** @brief A callback to invoke when a syncpoint is reached */
+typedef struct {
+    rspq_syncpoint_t sync_id;           ///< Syncpoint that triggers the callback
+    rspq_syncpoint_callback_t cb;       ///< Callback function
+    void *arg;                          ///< Argument of the callback
+} rspq_syncpoint_cb_t;
+
+/** @brief Circular buffer of pending syncpoint callbacks, in syncpoint order */
+static rspq_syncpoint_cb_t rspq_syncpoint_cbs[RSPQ_MAX_SYNCPOINT_CALLBACKS];
+/** @brief Index of the oldest pending callback (advanced by the interrupt handler) */
+static volatile int rspq_syncpoint_cbs_head;
+/** @brief Index where the next callback will be added */
+static volatile int rspq_syncpoint_cbs_tail;
+
 /** @brief True if the RSP queue engine is running in the RSP. */
 static bool rspq_is_running;
 
+/** @brief Statistics about buffer stalls and RSP idle time */
+static rspq_stats_t rspq_stats;
+
+/** @brief Address of the command buffer in DMEM (RSPQ_DMEM_BUFFER in rsp_queue.inc) */
+#define RSPQ_DMEM_BUFFER_ADDR   (RSPQ_DEBUG ? 0x150 : 0x108)
+
+/** @brief Address of the profiling counters in DMEM (RSPQ_PROFILE_SLOTS in rsp_queue.inc) */
+#define RSPQ_PROFILE_DMEM_ADDR  (RSPQ_DMEM_BUFFER_ADDR + RSPQ_DMEM_BUFFER_SIZE)
+
+/** @brief Profiling counters of an overlay, in DMEM (see rsp_queue.inc) */
+typedef struct {
+    uint32_t ticks;                     ///< DP_CLOCK cycles spent in the commands of the overlay
+    uint32_t commands;                  ///< Number of commands run
+    uint32_t loads;                     ///< Number of times the overlay was loaded
+} rspq_profile_slot_t;
+
+/** @brief Profiling counters in DMEM (see rsp_queue.inc) */
+typedef struct {
+    rspq_profile_slot_t slots[RSPQ_MAX_OVERLAY_COUNT];  ///< Counters of each overlay
+    uint32_t resident_loads;            ///< Number of loads of the resident overlay
+    uint32_t resident_bytes;            ///< Bytes of code not reloaded thanks to residency
+} rspq_profile_dmem_t;
+
+/// @cond
+_Static_assert(sizeof(rspq_profile_slot_t) == RSPQ_PROFILE_SLOT_SIZE);
+_Static_assert(RSPQ_PROFILE_MAX_OVERLAYS == RSPQ_MAX_OVERLAY_COUNT);
+_Static_assert(offsetof(rsp_queue_t, resident_code) % 8 == 0);
+_Static_assert(offsetof(rsp_queue_t, resident_clobbered) + 2 == offsetof(rsp_queue_t, resident_code) + 8);
+/// @endcond
+
+/** @brief Profile accumulated from the DMEM counters (saves are computed by #rspq_profile_get) */
+static rspq_profile_t rspq_profile;
+/** @brief Index of the overlay that was loaded when the profile was reset */
+static int rspq_profile_first_ovl;
+
 /** @brief Dummy state used for overlay 0 */
 static uint64_t dummy_overlay_state;
 
@@ -472,6 +531,17 @@ static void rspq_sp_interrupt(void)
 
     if (wstatus)
         *SP_STATUS = wstatus;
+
+    // Run the callbacks of the syncpoints reached so far. This is done after
+    // clearing the signal, so that the RSP can proceed to the next syncpoint
+    // meanwhile.
+    while (rspq_syncpoint_cbs_head != rspq_syncpoint_cbs_tail) {
+        rspq_syncpoint_cb_t *cb = &rspq_syncpoint_cbs[rspq_syncpoint_cbs_head];
+        if (!rspq_syncpoint_check(cb->sync_id))
+            break;
+        cb->cb(cb->arg);
+        rspq_syncpoint_cbs_head = (rspq_syncpoint_cbs_head + 1) % RSPQ_MAX_SYNCPOINT_CALLBACKS;
+    }
 }
 
 /** @brief Extract the current overlay index and name from the RSP queue state */
@@ -491,7 +561,7 @@ static void rspq_crash_handler(rsp_snapshot_t *state)
 {
     rsp_queue_t *rspq = (rsp_queue_t*)state->dmem;
     uint32_t cur = rspq->rspq_dram_addr + state->gpr[28];
-    uint32_t dmem_buffer = RSPQ_DEBUG ? 0x140 : 0x100;
+    uint32_t dmem_buffer = RSPQ_DMEM_BUFFER_ADDR;
 
     int ovl_idx; const char *ovl_name;
     rspq_get_current_ovl(rspq, &ovl_idx, &ovl_name);
@@ -527,8 +597,7 @@ static void rspq_assert_invalid_command(rsp_snapshot_t *state)
     int ovl_idx; const char *ovl_name;
     rspq_get_current_ovl(rspq, &ovl_idx, &ovl_name);
 
-    uint32_t dmem_buffer = RSPQ_DEBUG ? 0x140 : 0x100;
-    uint32_t cur = dmem_buffer + state->gpr[28];
+    uint32_t cur = RSPQ_DMEM_BUFFER_ADDR + state->gpr[28];
     printf("Invalid command\nCommand %02x not found in overlay %s (0x%01x)\n", state->dmem[cur], ovl_name, ovl_idx);
 }
 
@@ -650,6 +719,9 @@ static void rspq_start(void)
 /** @brief Initialize a rspq_ctx_t structure */
 static void rspq_init_context(rspq_ctx_t *ctx, int buf_size)
 {
+    // Each buffer must fit at least a command plus the jump to the other buffer
+    assertf(buf_size >= RSPQ_MAX_COMMAND_SIZE * 2, "rspq buffer too small: %d words", buf_size);
+
     memset(ctx, 0, sizeof(rspq_ctx_t));
     ctx->buffers[0] = malloc_uncached(buf_size * sizeof(uint32_t));
     ctx->buffers[1] = malloc_uncached(buf_size * sizeof(uint32_t));
@@ -668,22 +740,34 @@ static void rspq_close_context(rspq_ctx_t *ctx)
 }
 
 void rspq_init(void)
+{
+    rspq_init_config(NULL);
+}
+
+void rspq_init_config(const rspq_config_t *config)
 {
     // Do nothing if rspq_init has already been called
     if (rspq_initialized)
         return;
 
+    int lowpri_size = RSPQ_DRAM_LOWPRI_BUFFER_SIZE;
+    int highpri_size = RSPQ_DRAM_HIGHPRI_BUFFER_SIZE;
+    if (config && config->lowpri_buffer_size)
+        lowpri_size = config->lowpri_buffer_size;
+    if (config && config->highpri_buffer_size)
+        highpri_size = config->highpri_buffer_size;
+
     rspq_ctx = NULL;
     rspq_cur_pointer = NULL;
     rspq_cur_sentinel = NULL;
 
     // Allocate RSPQ contexts
-    rspq_init_context(&lowpri, RSPQ_DRAM_LOWPRI_BUFFER_SIZE);
+    rspq_init_context(&lowpri, lowpri_size);
     lowpri.sp_status_bufdone = SP_STATUS_SIG_BUFDONE_LOW;
     lowpri.sp_wstatus_set_bufdone = SP_WSTATUS_SET_SIG_BUFDONE_LOW;
     lowpri.sp_wstatus_clear_bufdone = SP_WSTATUS_CLEAR_SIG_BUFDONE_LOW;
 
-    rspq_init_context(&highpri, RSPQ_DRAM_HIGHPRI_BUFFER_SIZE);
+    rspq_init_context(&highpri, highpri_size);
     highpri.sp_status_bufdone = SP_STATUS_SIG_BUFDONE_HIGH;
     highpri.sp_wstatus_set_bufdone = SP_WSTATUS_SET_SIG_BUFDONE_HIGH;
     highpri.sp_wstatus_clear_bufdone = SP_WSTATUS_CLEAR_SIG_BUFDONE_HIGH;
@@ -703,11 +787,17 @@ void rspq_init(void)
     // Init syncpoints
     rspq_syncpoints_genid = 0;
     rspq_syncpoints_done = 0;
+    rspq_syncpoint_cbs_head = 0;
+    rspq_syncpoint_cbs_tail = 0;
 
     // Init blocks
     rspq_block = NULL;
     rspq_is_running = false;
 
+    rspq_stats_reset();
+    memset(&rspq_profile, 0, sizeof(rspq_profile));
+    rspq_profile_first_ovl = 0;
+
     // Activate SP interrupt (used for syncpoints)
     register_SP_handler(rspq_sp_interrupt);
     set_SP_interrupt(1);
@@ -958,6 +1048,12 @@ void rspq_overlay_unregister(uint32_t overlay_id)
     data_cache_hit_writeback_invalidate(overlay_header, sizeof(rspq_overlay_header_t));
 
     rspq_update_tables(false);
+
+    // Forget the resident overlay (code, size and clobbered bytes), as a new
+    // overlay could be registered later with its code at the same address.
+    static uint64_t zero __attribute__((aligned(16)));
+    data_cache_hit_writeback(&zero, sizeof(zero));
+    rspq_dma_to_dmem(offsetof(rsp_queue_t, resident_code), &zero, sizeof(zero), false);
 }
 
 /**
@@ -998,12 +1094,16 @@ void rspq_next_buffer(void) {
     // so that the kernel can switch away while waiting. Even
     // if the overhead of an interrupt is obviously higher.
     MEMORY_BARRIER();
+    rspq_stats.buffer_switches++;
     if (!(*SP_STATUS & rspq_ctx->sp_status_bufdone)) {
+        uint32_t t0 = TICKS_READ();
         rspq_flush_internal();
         RSP_WAIT_LOOP(200) {
             if (*SP_STATUS & rspq_ctx->sp_status_bufdone)
                 break;
         }
+        rspq_stats.buffer_stalls++;
+        rspq_stats.buffer_stall_ticks += TICKS_DISTANCE(t0, TICKS_READ());
     }
     MEMORY_BARRIER();
     *SP_STATUS = rspq_ctx->sp_wstatus_clear_bufdone;
@@ -1026,6 +1126,11 @@ void rspq_next_buffer(void) {
 __attribute__((noinline))
 static void rspq_flush_internal(void)
 {
+    // Count the times the RSP had run out of commands and halted itself
+    MEMORY_BARRIER();
+    if (*SP_STATUS & SP_STATUS_HALTED)
+        rspq_stats.rsp_idle++;
+
     // Tell the RSP to wake up because there is more data pending.
     MEMORY_BARRIER();
     *SP_STATUS = SP_WSTATUS_SET_SIG_MORE | SP_WSTATUS_CLEAR_HALT | SP_WSTATUS_CLEAR_BROKE;
@@ -1057,6 +1162,16 @@ void rspq_flush(void)
     rspq_flush_internal();
 }
 
+void rspq_stats_get(rspq_stats_t *stats)
+{
+    *stats = rspq_stats;
+}
+
+void rspq_stats_reset(void)
+{
+    memset(&rspq_stats, 0, sizeof(rspq_stats));
+}
+
 void rspq_highpri_begin(void)
 {
     assertf(rspq_ctx != &highpri, "already in highpri mode");
@@ -1231,6 +1346,30 @@ rspq_syncpoint_t rspq_syncpoint_new(void)
     return ++rspq_syncpoints_genid;
 }
 
+rspq_syncpoint_t rspq_syncpoint_new_cb(rspq_syncpoint_callback_t cb, void *arg)
+{
+    assertf(!rspq_block, "cannot create syncpoint in a block");
+    assertf(rspq_ctx != &highpri, "cannot create syncpoint in highpri mode");
+
+    // If the buffer is full, wait for the oldest callback to be run.
+    int tail = rspq_syncpoint_cbs_tail;
+    int next_tail = (tail + 1) % RSPQ_MAX_SYNCPOINT_CALLBACKS;
+    if (next_tail == rspq_syncpoint_cbs_head)
+        rspq_syncpoint_wait(rspq_syncpoint_cbs[rspq_syncpoint_cbs_head].sync_id);
+
+    // Publish the callback before creating the syncpoint. The interrupt
+    // handler cannot run it earlier, as the syncpoint does not exist yet.
+    rspq_syncpoint_cbs[tail] = (rspq_syncpoint_cb_t){
+        .sync_id = rspq_syncpoints_genid + 1,
+        .cb = cb,
+        .arg = arg,
+    };
+    MEMORY_BARRIER();
+    rspq_syncpoint_cbs_tail = next_tail;
+
+    return rspq_syncpoint_new();
+}
+
 bool rspq_syncpoint_check(rspq_syncpoint_t sync_id) 
 {
     int difference = (int)((uint32_t)(sync_id) - (uint32_t)(rspq_syncpoints_done));
@@ -1248,12 +1387,20 @@ void rspq_syncpoint_wait(rspq_syncpoint_t sync_id)
     // Make sure the RSP is running, otherwise we might be blocking forever.
     rspq_flush_internal();
 
-    // Spinwait until the the syncpoint is reached.
-    // TODO: with the kernel, it will be possible to wait for the RSP interrupt
-    // to happen, without spinwaiting.
-    RSP_WAIT_LOOP(200) {
-        if (rspq_syncpoint_check(sync_id))
-            break;
+    // Wait for the SP interrupt to signal the syncpoint. The counter lives in
+    // the data cache, so the loop does not access the bus, while the RSP
+    // status is checked only once per millisecond to catch RSP crashes.
+    uint32_t t0 = TICKS_READ();
+    uint32_t next_check = t0 + TICKS_FROM_MS(1);
+    while (!rspq_syncpoint_check(sync_id)) {
+        uint32_t now = TICKS_READ();
+        if (TICKS_BEFORE(now, next_check))
+            continue;
+        next_check = now + TICKS_FROM_MS(1);
+
+        __rsp_check_assert(__FILE__, __LINE__, __func__);
+        if (TICKS_DISTANCE(t0, now) > TICKS_FROM_MS(200))
+            rsp_crashf("wait loop timed out (%d ms)", 200);
     }
 }
 
@@ -1280,8 +1427,79 @@ void rspq_dma_to_dmem(uint32_t dmem_addr, void *rdram_addr, uint32_t len, bool i
     rspq_dma(rdram_addr, dmem_addr, len - 1, is_async ? 0 : SP_STATUS_DMA_BUSY | SP_STATUS_DMA_FULL);
 }
 
+/**
+ * @brief Fetch the profiling counters from DMEM and add them to #rspq_profile.
+ * 
+ * The DMEM counters are cleared after being read, so that they never
+ * overflow as long as the profile is read often enough.
+ * 
+ * @return Index of the overlay currently loaded
+ */
+static int rspq_profile_fetch(void)
+{
+#if RSPQ_PROFILE
+    static rspq_profile_dmem_t zero __attribute__((aligned(16)));
+    rspq_profile_dmem_t counters __attribute__((aligned(16)));
+    uint32_t queue_state[4] __attribute__((aligned(16)));
+
+    assertf(get_interrupts_state() == INTERRUPTS_ENABLED, "deadlock: interrupts are disabled");
+
+    data_cache_hit_writeback(&zero, sizeof(zero));
+    data_cache_hit_writeback_invalidate(&counters, sizeof(counters));
+    data_cache_hit_writeback_invalidate(queue_state, sizeof(queue_state));
+
+    // Read and clear the counters in a single highpri sequence, so that no
+    // other command (e.g. another highpri sequence) can run in between and
+    // have its counts lost.
+    rspq_wait();
+    rspq_highpri_begin();
+    rspq_dma_to_rdram(&counters, RSPQ_PROFILE_DMEM_ADDR, sizeof(counters), false);
+    rspq_dma_to_rdram(queue_state, offsetof(rsp_queue_t, rspq_dram_addr), 8, false);
+    rspq_dma_to_dmem(RSPQ_PROFILE_DMEM_ADDR, &zero, sizeof(zero), false);
+    rspq_highpri_end();
+    rspq_highpri_sync();
+
+    for (int i=0; i<RSPQ_MAX_OVERLAY_COUNT; i++) {
+        rspq_profile.overlays[i].rcp_cycles += counters.slots[i].ticks;
+        rspq_profile.overlays[i].commands += counters.slots[i].commands;
+        rspq_profile.overlays[i].loads += counters.slots[i].loads;
+    }
+    rspq_profile.resident_loads += counters.resident_loads;
+    rspq_profile.resident_bytes_saved += counters.resident_bytes;
+
+    // current_ovl is the 16-bit word after rspq_dram_addr
+    return (queue_state[1] >> 16) / sizeof(rspq_overlay_t);
+#else
+    assertf(0, "rspq profiling requires building libdragon and overlays with RSPQ_PROFILE=1");
+    return 0;
+#endif
+}
+
+void rspq_profile_get(rspq_profile_t *profile)
+{
+    int cur_ovl = rspq_profile_fetch();
+
+    *profile = rspq_profile;
+    for (int i=0; i<RSPQ_MAX_OVERLAY_COUNT; i++) {
+        rspq_profile_overlay_t *ovl = &profile->overlays[i];
+        ovl->ucode = i ? rspq_overlay_ucodes[i] : NULL;
+
+        // Each load saves the state of the overlay being replaced, so an
+        // overlay is saved every time it was loaded, except while it is
+        // still loaded.
+        ovl->saves = ovl->loads + (i == rspq_profile_first_ovl) - (i == cur_ovl);
+    }
+}
+
+void rspq_profile_reset(void)
+{
+    rspq_profile_first_ovl = rspq_profile_fetch();
+    memset(&rspq_profile, 0, sizeof(rspq_profile));
+}
+
 
 /* Extern inline instantiations. */
 extern inline rspq_write_t rspq_write_begin(uint32_t ovl_id, uint32_t cmd_id, int size);
 extern inline void rspq_write_arg(rspq_write_t *w, uint32_t value);
 extern inline void rspq_write_end(rspq_write_t *w);
+extern inline rspq_write_t rspq_write_reserve(uint32_t ovl_id, uint32_t cmd_id, uint32_t arg0, int size);
@@ -189,6 +189,35 @@ void test_rspq_wrap(TestContext *ctx)
     TEST_RSPQ_EPILOG(0, rspq_timeout);
 }
 
+void test_rspq_buffer_config(TestContext *ctx)
+{
+    rspq_init_config(&(rspq_config_t){
+        .lowpri_buffer_size = RSPQ_MAX_COMMAND_SIZE * 2,
+    });
+    DEFER(rspq_close());
+
+    test_ovl_init();
+    DEFER(test_ovl_close());
+
+    for (uint32_t i = 0; i < 1000; i++)
+        rspq_test_8(1);
+
+    uint64_t actual_sum[2] __attribute__((aligned(16))) = {0};
+    data_cache_hit_writeback_invalidate(actual_sum, 16);
+
+    rspq_test_output(actual_sum);
+
+    TEST_RSPQ_EPILOG(0, rspq_timeout);
+
+    ASSERT_EQUAL_UNSIGNED(*actual_sum, 1000, "Sum is incorrect!");
+
+    // 1000 commands of 2 words need at least 15 buffers of 126 words
+    rspq_stats_t stats;
+    rspq_stats_get(&stats);
+    ASSERT(stats.buffer_switches >= 15, "Too few buffer switches: %ld", stats.buffer_switches);
+    ASSERT(stats.buffer_stalls <= stats.buffer_switches, "More stalls than switches: %ld/%ld", stats.buffer_stalls, stats.buffer_switches);
+}
+
 void test_rspq_signal(TestContext *ctx)
 {
     TEST_RSPQ_PROLOG();
@@ -437,6 +466,82 @@ void test_rspq_rapid_sync(TestContext *ctx)
     }
 }
 
+static int test_syncpoint_cb_count;
+
+static void test_syncpoint_cb(void *arg)
+{
+    *(int*)arg = ++test_syncpoint_cb_count;
+}
+
+void test_rspq_syncpoint_callback(TestContext *ctx)
+{
+    TEST_RSPQ_PROLOG();
+
+    // More than RSPQ_MAX_SYNCPOINT_CALLBACKS, to go through a full buffer
+    int order[100] = {0};
+    test_syncpoint_cb_count = 0;
+
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        rspq_noop();
+        rspq_syncpoint_new_cb(test_syncpoint_cb, &order[i]);
+    }
+
+    TEST_RSPQ_EPILOG(0, rspq_timeout);
+
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        ASSERT_EQUAL_SIGNED(order[i], i+1, "Callback not run in order!");
+    }
+}
+
+#if RSPQ_PROFILE
+void test_rspq_profile(TestContext *ctx)
+{
+    TEST_RSPQ_PROLOG();
+    test_ovl_init();
+    DEFER(test_ovl_close());
+
+    rspq_profile_reset();
+
+    // Alternate the two overlays, so that each of them is loaded 5 times
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        rspq_test_8(1);
+        rspq_test_8(1);
+        rspq_test2(0, 0);
+    }
+
+    rspq_profile_t profile;
+    rspq_profile_get(&profile);
+
+    int found = 0;
+    for (int i = 0; i < RSPQ_PROFILE_MAX_OVERLAYS; i++)
+    {
+        rspq_profile_overlay_t *ovl = &profile.overlays[i];
+        if (ovl->ucode == &rsp_test) {
+            ASSERT_EQUAL_UNSIGNED(ovl->commands, 10, "Wrong command count for rsp_test");
+            ASSERT_EQUAL_UNSIGNED(ovl->loads, 5, "Wrong load count for rsp_test");
+            ASSERT(ovl->rcp_cycles > 0, "No time charged to rsp_test");
+            found++;
+        }
+        if (ovl->ucode == &rsp_test2) {
+            ASSERT_EQUAL_UNSIGNED(ovl->commands, 5, "Wrong command count for rsp_test2");
+            ASSERT_EQUAL_UNSIGNED(ovl->loads, 5, "Wrong load count for rsp_test2");
+            found++;
+        }
+    }
+    ASSERT_EQUAL_SIGNED(found, 2, "Overlays not found in the profile");
+
+    // rsp_test is bigger than rsp_test2, so it stays resident after its
+    // first load, and is only partially reloaded afterwards
+    ASSERT_EQUAL_UNSIGNED(profile.resident_loads, 4, "Wrong resident load count");
+    ASSERT(profile.resident_bytes_saved > 0, "No code transfer saved by resident loads");
+
+    TEST_RSPQ_EPILOG(0, rspq_timeout);
+}
+#endif
+
 void test_rspq_block(TestContext *ctx)
 {
     TEST_RSPQ_PROLOG();
@@ -744,3 +849,39 @@ void test_rspq_big_command(TestContext *ctx)
     
     ASSERT_EQUAL_MEM((uint8_t*)output, (uint8_t*)expected, 128, "Output does not match!");
 }
+
+void test_rspq_write_reserve(TestContext *ctx)
+{
+    TEST_RSPQ_PROLOG();
+    test_ovl_init();
+    DEFER(test_ovl_close());
+
+    uint32_t values[32];
+    for (uint32_t i = 0; i < 32; i++)
+    {
+        values[i] = RANDN(0xFFFFFFFF);
+    }
+
+    uint32_t output[32] __attribute__((aligned(16)));
+    data_cache_hit_writeback_invalidate(output, 128);
+
+    // Enough commands to go through a few buffer switches
+    uint32_t expected[32] = {0};
+    for (uint32_t j = 0; j < 64; j++)
+    {
+        rspq_write_t w = rspq_write_reserve(test_ovl_id, 0x8, 0, 33);
+        for (uint32_t i = 0; i < 32; i++)
+        {
+            uint32_t x = values[i] * (j + 1);
+            w.pointer[i] = x;
+            expected[i] ^= x;
+        }
+        rspq_write_end(&w);
+    }
+
+    rspq_test_big_out(output);
+
+    TEST_RSPQ_EPILOG(0, rspq_timeout);
+
+    ASSERT_EQUAL_MEM((uint8_t*)output, (uint8_t*)expected, 128, "Output does not match!");
+}
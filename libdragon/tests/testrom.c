@@ -213,6 +213,7 @@ static const struct Testsuite
 	TEST_FUNC(test_rspq_queue_multiple,        0, TEST_FLAGS_NO_BENCHMARK),
 	TEST_FUNC(test_rspq_queue_rapid,           0, TEST_FLAGS_NO_BENCHMARK),
 	TEST_FUNC(test_rspq_wrap,                  0, TEST_FLAGS_NO_BENCHMARK),
+	TEST_FUNC(test_rspq_buffer_config,         0, TEST_FLAGS_NO_BENCHMARK),
 	TEST_FUNC(test_rspq_signal,                0, TEST_FLAGS_NO_BENCHMARK),
 	TEST_FUNC(test_rspq_high_load,             0, TEST_FLAGS_NO_BENCHMARK),
 	TEST_FUNC(test_rspq_load_overlay,          0, TEST_FLAGS_NO_BENCHMARK),
@@ -220,6 +221,7 @@ static const struct Testsuite
 	TEST_FUNC(test_rspq_multiple_flush,        0, TEST_FLAGS_NO_BENCHMARK),
 	TEST_FUNC(test_rspq_wait,                  0, TEST_FLAGS_NO_BENCHMARK),
 	TEST_FUNC(test_rspq_rapid_sync,            0, TEST_FLAGS_NO_BENCHMARK),
+	TEST_FUNC(test_rspq_syncpoint_callback,    0, TEST_FLAGS_NO_BENCHMARK),
 	TEST_FUNC(test_rspq_flush,                 0, TEST_FLAGS_NO_BENCHMARK | TEST_FLAGS_NO_EMULATOR),
 	TEST_FUNC(test_rspq_rapid_flush,           0, TEST_FLAGS_NO_BENCHMARK | TEST_FLAGS_NO_EMULATOR),
 	TEST_FUNC(test_rspq_block,                 0, TEST_FLAGS_NO_BENCHMARK),
@@ -228,6 +230,10 @@ static const struct Testsuite
 	TEST_FUNC(test_rspq_highpri_multiple,      0, TEST_FLAGS_NO_BENCHMARK),
 	TEST_FUNC(test_rspq_highpri_overlay,       0, TEST_FLAGS_NO_BENCHMARK),
 	TEST_FUNC(test_rspq_big_command,           0, TEST_FLAGS_NO_BENCHMARK),
+	TEST_FUNC(test_rspq_write_reserve,         0, TEST_FLAGS_NO_BENCHMARK),
+#if RSPQ_PROFILE
+	TEST_FUNC(test_rspq_profile,               0, TEST_FLAGS_NO_BENCHMARK),
+#endif
 };
 
 int main() {
@@ -0,0 +1,252 @@
+/*
+ * n64prof - symbolize a profile dumped by the libdragon sampling profiler
+ *
+ * Reads a debug log captured over ISViewer/USB, extracts the last profile
+ * (between the @@PROFILE-BEGIN@@ and @@PROFILE-END@@ markers) and maps the
+ * samples to the functions of the ELF file, using nm from the toolchain.
+ * It prints a flat profile by function, and a caller/callee profile built
+ * from the return addresses recorded with each sample.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef struct {
+    uint32_t addr;
+    char *name;
+} symbol_t;
+
+typedef struct {
+    int sym;
+    uint32_t count;
+} sym_count_t;
+
+typedef struct {
+    int caller, callee;
+    uint32_t count;
+} edge_count_t;
+
+static symbol_t *syms;
+static int num_syms;
+
+static sym_count_t *flat;
+static int num_flat;
+
+static edge_count_t *edges;
+static int num_edges;
+
+static void print_args(char *name)
+{
+    fprintf(stderr, "Usage: %s [-n <nm>] <elf> <log>\n", name);
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Symbolize the last profile dumped by profiler_dump() in a debug log.\n");
+    fprintf(stderr, "\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "   -n <nm>   nm executable to use (default: $N64_INST/bin/mips64-elf-nm)\n");
+}
+
+static int sym_cmp(const void *a, const void *b)
+{
+    uint32_t aa = ((const symbol_t*)a)->addr, bb = ((const symbol_t*)b)->addr;
+    return aa < bb ? -1 : aa > bb;
+}
+
+/* Load the code symbols of the ELF file, sorted by address */
+static int load_symbols(const char *nm, const char *elf)
+{
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd), "\"%s\" -n --defined-only \"%s\"", nm, elf);
+
+    FILE *f = popen(cmd, "r");
+    if (!f) return -1;
+
+    char line[1024];
+    int cap = 0;
+    while (fgets(line, sizeof(line), f)) {
+        char type, name[900];
+        unsigned long long addr;
+        if (sscanf(line, "%llx %c %899s", &addr, &type, name) != 3)
+            continue;
+        if (type != 't' && type != 'T' && type != 'W' && type != 'w')
+            continue;
+
+        if (num_syms == cap) {
+            cap = cap ? cap * 2 : 1024;
+            syms = realloc(syms, cap * sizeof(symbol_t));
+        }
+        syms[num_syms].addr = (uint32_t)addr;
+        syms[num_syms].name = strdup(name);
+        num_syms++;
+    }
+
+    if (pclose(f) != 0 || num_syms == 0)
+        return -1;
+
+    qsort(syms, num_syms, sizeof(symbol_t), sym_cmp);
+    return 0;
+}
+
+/* Index of the function containing addr, or -1 */
+static int find_symbol(uint32_t addr)
+{
+    int lo = 0, hi = num_syms - 1, found = -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (syms[mid].addr <= addr) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return found;
+}
+
+static void add_flat(int sym, uint32_t count)
+{
+    for (int i = 0; i < num_flat; i++) {
+        if (flat[i].sym == sym) {
+            flat[i].count += count;
+            return;
+        }
+    }
+    flat = realloc(flat, (num_flat + 1) * sizeof(sym_count_t));
+    flat[num_flat].sym = sym;
+    flat[num_flat].count = count;
+    num_flat++;
+}
+
+static void add_edge(int caller, int callee, uint32_t count)
+{
+    for (int i = 0; i < num_edges; i++) {
+        if (edges[i].caller == caller && edges[i].callee == callee) {
+            edges[i].count += count;
+            return;
+        }
+    }
+    edges = realloc(edges, (num_edges + 1) * sizeof(edge_count_t));
+    edges[num_edges].caller = caller;
+    edges[num_edges].callee = callee;
+    edges[num_edges].count = count;
+    num_edges++;
+}
+
+static int flat_cmp(const void *a, const void *b)
+{
+    uint32_t aa = ((const sym_count_t*)a)->count, bb = ((const sym_count_t*)b)->count;
+    return aa > bb ? -1 : aa < bb;
+}
+
+static int edge_cmp(const void *a, const void *b)
+{
+    uint32_t aa = ((const edge_count_t*)a)->count, bb = ((const edge_count_t*)b)->count;
+    return aa > bb ? -1 : aa < bb;
+}
+
+static const char *sym_name(int sym)
+{
+    return sym >= 0 ? syms[sym].name : "<unknown>";
+}
+
+int main(int argc, char *argv[])
+{
+    char nm[512];
+    const char *elf = NULL, *log = NULL;
+    int i;
+
+    if (getenv("N64_INST"))
+        snprintf(nm, sizeof(nm), "%s/bin/mips64-elf-nm", getenv("N64_INST"));
+    else
+        strcpy(nm, "mips64-elf-nm");
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            snprintf(nm, sizeof(nm), "%s", argv[++i]);
+        } else if (!elf) {
+            elf = argv[i];
+        } else if (!log) {
+            log = argv[i];
+        } else {
+            print_args(argv[0]);
+            return -1;
+        }
+    }
+
+    if (!elf || !log) {
+        print_args(argv[0]);
+        return -1;
+    }
+
+    if (load_symbols(nm, elf) < 0) {
+        fprintf(stderr, "Cannot read symbols from %s with %s\n", elf, nm);
+        return -1;
+    }
+
+    FILE *f = fopen(log, "r");
+    if (!f) {
+        fprintf(stderr, "Cannot open file: %s\n", log);
+        return -1;
+    }
+
+    /* Only the last complete profile in the log is used */
+    char line[1024];
+    long start = -1;
+    while (fgets(line, sizeof(line), f))
+        if (strstr(line, "@@PROFILE-BEGIN@@"))
+            start = ftell(f);
+
+    if (start < 0) {
+        fprintf(stderr, "No profile found in %s (profiler_dump outputs nothing in NDEBUG builds)\n", log);
+        return -1;
+    }
+    fseek(f, start, SEEK_SET);
+
+    int frequency = 0, shift = 0;
+    unsigned long text_start = 0, samples = 0, outside = 0, dropped = 0;
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long a, b, c;
+        if (strstr(line, "@@PROFILE-END@@"))
+            break;
+
+        if (sscanf(line, "P %d %lx %d %lu %lu %lu", &frequency, &text_start, &shift, &samples, &outside, &dropped) == 6)
+            continue;
+        if (sscanf(line, "H %lx %lu", &a, &b) == 2) {
+            add_flat(find_symbol(a), b);
+            continue;
+        }
+        if (sscanf(line, "E %lx %lx %lu", &a, &b, &c) == 3) {
+            /* ra points after the delay slot of the call */
+            int callee = find_symbol(a), caller = find_symbol(b - 8);
+            /* A return address inside the same function is stale: it is the
+               one of a call that already returned. */
+            if (caller != callee)
+                add_edge(caller, callee, c);
+            continue;
+        }
+    }
+    fclose(f);
+
+    if (!samples) {
+        fprintf(stderr, "Empty profile\n");
+        return -1;
+    }
+
+    printf("Samples: %lu at %d Hz (%.2f s), outside text: %lu, edges dropped: %lu\n\n",
+        samples, frequency, (double)samples / frequency, outside, dropped);
+
+    qsort(flat, num_flat, sizeof(sym_count_t), flat_cmp);
+    printf("Flat profile:\n\n");
+    printf("  %%time   samples  function\n");
+    for (i = 0; i < num_flat; i++)
+        printf("%7.2f %9u  %s\n", flat[i].count * 100.0 / samples, flat[i].count, sym_name(flat[i].sym));
+
+    qsort(edges, num_edges, sizeof(edge_count_t), edge_cmp);
+    printf("\nCall profile (immediate caller, exact for leaf functions):\n\n");
+    printf("  %%time   samples  caller -> callee\n");
+    for (i = 0; i < num_edges; i++)
+        printf("%7.2f %9u  %s -> %s\n", edges[i].count * 100.0 / samples, edges[i].count,
+            sym_name(edges[i].caller), sym_name(edges[i].callee));
+
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include "systembench.h"
+
+static volatile struct AI_regs_s * const AI_regs = (struct AI_regs_s *)0xa4500000;
+
+#define AI_STATUS_BUSY           (1 << 30)
+#define AI_STATUS_FULL           (1 << 31)
+
+// Uncached reads done in each sample of the buffer cost benchmark. They take
+// a few milliseconds, well below the playback time of a single buffer.
+#define AI_READ_LOOP             8192
+
+typedef enum {
+    AI_START,               // From the length write to the first DMA fetch
+    AI_U32R,                // Uncached 32-bit read while a buffer plays
+    AI_BUFFER,              // CPU time stolen from uncached reads per buffer
+} ai_metric_t;
+
+static const char *ai_metric_names[] = { "start", "U32R", "buffer" };
+
+static const struct {
+    const char *name;
+    int frequency;
+} ai_freqs[] = {
+    { "22kHz",   22050 },
+    { "32kHz",   32000 },
+    { "44.1kHz", 44100 },
+    { "48kHz",   48000 },
+};
+
+// DAC clock rates used by audio_init() to derive the real playback rate
+#define AI_NTSC_DACRATE          48681812
+#define AI_PAL_DACRATE           49656530
+#define AI_MPAL_DACRATE          48628316
+
+static int16_t *ai_buf, *ai_buf_orig;
+static uint32_t ai_len;
+
+// Let audio_init() program the DAC rate for the frequency, and allocate a
+// buffer of the size it would use, which is then driven directly.
+static void ai_begin(int frequency) {
+    audio_init(frequency, 0);
+    ai_len = audio_get_buffer_length() * 2 * sizeof(int16_t);
+    ai_buf = ai_buf_orig = malloc_uncached(ai_len + 8);
+
+    // Same workaround of audio.c for the AI DMA carry bug
+    if (((uint32_t)ai_buf + ai_len) % 0x2000 == 0)
+        ai_buf += 4;
+    memset(ai_buf, 0, ai_len);
+
+    AI_regs->control = 1;
+}
+
+// Size in bytes of the buffers that audio_init() allocates for a frequency.
+// Same computation as audio.c, which sizes them from the real DAC rate
+// rather than the requested frequency.
+static int ai_buffer_bytes(int frequency) {
+    int clockrate;
+    switch (get_tv_type()) {
+    case TV_PAL:  clockrate = AI_PAL_DACRATE; break;
+    case TV_MPAL: clockrate = AI_MPAL_DACRATE; break;
+    default:      clockrate = AI_NTSC_DACRATE; break;
+    }
+    int real = 2 * clockrate / ((2 * clockrate / frequency) + 1);
+    return ((real / 25) >> 3 << 3) * 2 * sizeof(int16_t);
+}
+
+static void ai_idle(void) {
+    while (AI_regs->status & (AI_STATUS_BUSY | AI_STATUS_FULL)) {}
+}
+
+static void ai_end(void) {
+    ai_idle();
+    AI_regs->control = 0;
+    free_uncached(ai_buf_orig);
+    audio_close();
+}
+
+// Queue buffers until the AI FIFO is full, so that playback continues for
+// at least one buffer after returning.
+static void ai_fill(void) {
+    while (!(AI_regs->status & AI_STATUS_FULL)) {
+        AI_regs->address = ai_buf;
+        AI_regs->length = ai_len;
+    }
+}
+
+static uint32_t ai_read_loop(void) {
+    volatile uint32_t *RAM = (volatile uint32_t*)UncachedAddr(rambuf);
+    uint32_t t0 = TICKS_READ();
+    for (int i=0; i<AI_READ_LOOP; i++)
+        (void)*RAM;
+    return TICKS_DISTANCE(t0, TICKS_READ());
+}
+
+// Time the read loop while the AI plays, and scale its slowdown compared to
+// an idle bus to the playback time of one buffer, at the real DAC rate.
+static xcycle_t ai_buffer_sample(uint32_t idle) {
+    ai_fill();
+    uint32_t busy = ai_read_loop();
+    if (busy <= idle) return 0;
+
+    uint64_t buffer_ticks = (uint64_t)audio_get_buffer_length() * (CPU_FREQUENCY / 2) / audio_get_frequency();
+    return XCYCLE_FROM_COP0((uint64_t)(busy - idle) * buffer_ticks / busy);
+}
+
+// args[0] is the frequency, args[1] the metric
+xcycle_t bench_ai(benchmark_t *b) {
+    int frequency = ai_freqs[b->args[0]].frequency;
+    ai_metric_t metric = b->args[1];
+    xcycle_t t = 0;
+
+    ai_begin(frequency);
+
+    switch (metric) {
+    case AI_START:
+        // The length register counts down as the DMA fetches samples
+        t = TIMEIT_WHILE_MULTI(20, ({
+            ai_idle();
+            AI_regs->address = ai_buf;
+        }), ({
+            AI_regs->length = ai_len;
+        }), AI_regs->length >= ai_len);
+        break;
+    case AI_U32R: {
+        volatile uint32_t *RAM = (volatile uint32_t*)UncachedAddr(rambuf);
+        ai_fill();
+        t = TIMEIT_MULTI(50, ({ }), ({ (void)*RAM; }));
+        break;
+    }
+    case AI_BUFFER: {
+        uint32_t idle = 0xFFFFFFFF;
+        for (int i=0; i<8; i++) {
+            uint32_t loop = ai_read_loop();
+            if (loop < idle) idle = loop;
+        }
+        t = SAMPLE_MULTI(20, ai_buffer_sample(idle));
+        break;
+    }
+    }
+
+    ai_end();
+    return t;
+}
+
+// Register start latency, uncached read latency during playback and stolen
+// time per buffer at the common playback rates. Buffers have the size picked
+// by audio_init(). Points are not graded; compare U32R with RDRAM U32R.
+__attribute__((constructor))
+static void bench_ai_register(void) {
+    char name[32];
+
+    for (int i=0; i < sizeof(ai_freqs)/sizeof(ai_freqs[0]); i++) {
+        int buf_bytes = ai_buffer_bytes(ai_freqs[i].frequency);
+
+        const struct { int qty; unit_t unit; } points[] = {
+            [AI_START]  = { 1,         UNIT_OPS },
+            [AI_U32R]   = { 4,         UNIT_BYTES },
+            [AI_BUFFER] = { buf_bytes, UNIT_BYTES },
+        };
+
+        for (ai_metric_t m=AI_START; m <= AI_BUFFER; m++) {
+            snprintf(name, sizeof(name), "AI %s %s", ai_freqs[i].name, ai_metric_names[m]);
+            benchmark_t *b = bench_new(bench_ai, CAT_AI, name,
+                points[m].qty, points[m].unit, CYCLE_CPU, 0);
+            b->args[0] = i;
+            b->args[1] = m;
+        }
+    }
+}
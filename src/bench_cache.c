@@ -0,0 +1,159 @@
+#include "systembench.h"
+
+#define DCACHE_SIZE              (8*1024)
+#define DCACHE_LINE              16
+#define ICACHE_SIZE              (16*1024)
+#define ICACHE_LINE              32
+
+// Straight-line code as big as the I-cache, ending with a return. Calling
+// it at (icache_sled_end - n) runs a function of n bytes.
+__asm__(
+    "    .text\n"
+    "    .align 5\n"
+    "icache_sled:\n"
+    "    .rept (16*1024-8)/4\n"
+    "    nop\n"
+    "    .endr\n"
+    "    jr $ra\n"
+    "    nop\n"
+    "icache_sled_end:\n"
+);
+extern uint8_t icache_sled_end[];
+
+static void icache_call(int n) {
+    ((void (*)(void))(icache_sled_end - n))();
+}
+
+// State of the cachelines covering the buffer before the operation
+typedef enum {
+    CACHE_ABSENT,
+    CACHE_CLEAN,
+    CACHE_DIRTY,
+} cache_state_t;
+
+#define CACHE_STATES_D           ((1 << CACHE_ABSENT) | (1 << CACHE_CLEAN) | (1 << CACHE_DIRTY))
+#define CACHE_STATES_I           ((1 << CACHE_ABSENT) | (1 << CACHE_CLEAN))
+
+static const char *cache_state_names[] = { "absent", "clean", "dirty" };
+
+// data_cache_hit_writeback takes a pointer to const, so it needs a wrapper with
+// the signature of the table.
+static void dcache_hit_wb(volatile void *addr, unsigned long length) {
+    data_cache_hit_writeback(addr, length);
+}
+
+static void dcache_all(volatile void *addr, unsigned long length) {
+    data_cache_writeback_invalidate_all();
+}
+
+static void icache_all(volatile void *addr, unsigned long length) {
+    inst_cache_invalidate_all();
+}
+
+// Read the lines that map to the same cache index as the buffer. As the
+// D-cache is direct mapped, each read evicts one line of the buffer.
+static void dcache_evict(volatile void *addr, unsigned long length) {
+    for (unsigned long i=0; i<length; i+=DCACHE_LINE)
+        (void)*(volatile uint8_t *)(addr + DCACHE_SIZE + i);
+}
+
+static const struct {
+    const char *name;
+    void (*func)(volatile void *addr, unsigned long length);
+    bool icache;
+    bool whole;             // Operates on the whole cache, size is fixed
+    uint32_t states;
+} cache_ops[] = {
+    { "DC hit WB",    dcache_hit_wb,                          false, false, CACHE_STATES_D },
+    { "DC hit INV",   __data_cache_hit_invalidate,            false, false, CACHE_STATES_D },
+    { "DC hit WBINV", data_cache_hit_writeback_invalidate,    false, false, CACHE_STATES_D },
+    { "DC idx WBINV", data_cache_index_writeback_invalidate,  false, false, CACHE_STATES_D },
+    { "DC all WBINV", dcache_all,                             false, true,  CACHE_STATES_D },
+    { "DC evict",     dcache_evict,                           false, false, (1 << CACHE_CLEAN) | (1 << CACHE_DIRTY) },
+    { "IC hit INV",   inst_cache_hit_invalidate,              true,  false, CACHE_STATES_I },
+    { "IC idx INV",   inst_cache_index_invalidate,            true,  false, CACHE_STATES_I },
+    { "IC all INV",   icache_all,                             true,  true,  CACHE_STATES_I },
+};
+
+// Sizes: a single line, 1 KiB, the whole cache
+#define CACHE_NUM_SIZES          3
+static const int dcache_sizes[CACHE_NUM_SIZES] = { DCACHE_LINE, 1024, DCACHE_SIZE };
+static const int icache_sizes[CACHE_NUM_SIZES] = { ICACHE_LINE, 1024, ICACHE_SIZE };
+
+// Bring the lines covering the buffer to the requested state. For the
+// I-cache, the buffer is the tail of icache_sled, and "clean" means that
+// it has been executed.
+static void cache_prepare(bool icache, uint8_t *buf, int size, cache_state_t state) {
+    if (icache) {
+        inst_cache_hit_invalidate(buf, size);
+        if (state == CACHE_CLEAN)
+            icache_call(size);
+        return;
+    }
+
+    data_cache_hit_writeback_invalidate(buf, size);
+    for (int i=0; i<size; i+=DCACHE_LINE) {
+        if (state == CACHE_CLEAN)
+            (void)*(volatile uint8_t *)(buf + i);
+        else if (state == CACHE_DIRTY)
+            *(volatile uint8_t *)(buf + i) = i;
+    }
+}
+
+// args[0] is the cache op, args[1] the state of the lines; qty is the size
+// of the buffer.
+xcycle_t bench_cache_op(benchmark_t *b) {
+    bool icache = cache_ops[b->args[0]].icache;
+    void (*func)(volatile void *, unsigned long) = cache_ops[b->args[0]].func;
+    cache_state_t state = b->args[1];
+    uint8_t *buf = icache ? icache_sled_end - b->qty : rambuf;
+    int size = b->qty;
+
+    return TIMEIT_MULTI(20, ({ cache_prepare(icache, buf, size, state); }), ({ func(buf, size); }));
+}
+
+// args[0] is 1 if the function is executed from a cold I-cache; qty is the
+// size of the function.
+xcycle_t bench_icache_exec(benchmark_t *b) {
+    bool cold = b->args[0];
+    int size = b->qty;
+
+    return TIMEIT_MULTI(20, ({
+        if (cold) inst_cache_hit_invalidate(icache_sled_end - size, size);
+        else icache_call(size);
+    }), ({
+        icache_call(size);
+    }));
+}
+
+// Register every cache op with each meaningful initial state, on a single
+// line, on 1 KiB and on the whole cache. Ops on the whole cache run once,
+// with the whole cache prepared. Then register execution of straight-line
+// functions of increasing size, from a cold and from a warm I-cache.
+__attribute__((constructor))
+static void bench_cache_register(void) {
+    char name[32];
+
+    for (int op=0; op < sizeof(cache_ops)/sizeof(cache_ops[0]); op++) {
+        const int *sizes = cache_ops[op].icache ? icache_sizes : dcache_sizes;
+        for (cache_state_t state=CACHE_ABSENT; state <= CACHE_DIRTY; state++) {
+            if (!(cache_ops[op].states & (1 << state))) continue;
+            snprintf(name, sizeof(name), "%s %s", cache_ops[op].name, cache_state_names[state]);
+            for (int i = cache_ops[op].whole ? CACHE_NUM_SIZES-1 : 0; i < CACHE_NUM_SIZES; i++) {
+                benchmark_t *b = bench_new(bench_cache_op, CAT_CACHE, name,
+                    sizes[i], UNIT_BYTES, CYCLE_CPU, 0);
+                b->args[0] = op;
+                b->args[1] = state;
+            }
+        }
+    }
+
+    for (int cold=1; cold >= 0; cold--) {
+        snprintf(name, sizeof(name), "IC exec %s", cold ? "cold" : "warm");
+        for (int size=ICACHE_LINE; size <= ICACHE_SIZE; size *= 2) {
+            benchmark_t *b = bench_new(bench_icache_exec, CAT_CACHE, name,
+                size, UNIT_BYTES, CYCLE_CPU, 0);
+            b->args[0] = cold;
+        }
+    }
+}
@@ -0,0 +1,148 @@
+#include "systembench.h"
+
+DEFINE_RSP_UCODE(rsp_dmaloop);
+
+// CPU-side benchmarks that are re-measured under load
+xcycle_t bench_ram_uncached_r32(benchmark_t *b);
+xcycle_t bench_ram_uncached_r64(benchmark_t *b);
+xcycle_t bench_ram_uncached_r32_seq(benchmark_t *b);
+xcycle_t bench_ram_uncached_r32_multibank(benchmark_t *b);
+xcycle_t bench_rcp_io_r(benchmark_t *b);
+
+static const struct {
+    const char *name;
+    int qty;
+    xcycle_t (*func)(benchmark_t *b);
+} loaded_benchs[] = {
+    { "U32R",        4, bench_ram_uncached_r32 },
+    { "U64R",        8, bench_ram_uncached_r64 },
+    { "U32R seq",  4*4, bench_ram_uncached_r32_seq },
+    { "U32R bnk",  4*4, bench_ram_uncached_r32_multibank },
+    { "RCP I/O R",   1, bench_rcp_io_r },
+};
+
+// Background traffic generators. Each one is started right before running
+// the measured benchmark, and keeps the bus busy for much longer than it.
+#define LOAD_SP_DMA              (1 << 0)
+#define LOAD_RDP_FILL            (1 << 1)
+#define LOAD_PI_DMA              (1 << 2)
+#define LOAD_VI                  (1 << 3)
+
+static const struct {
+    const char *name;
+    uint32_t loads;
+    resolution_t res;
+    bitdepth_t bpp;
+} scenarios[] = {
+    { "SP DMA",        LOAD_SP_DMA },
+    { "RDP fill",      LOAD_RDP_FILL },
+    { "PI DMA",        LOAD_PI_DMA },
+    { "VI 320x240x16", LOAD_VI, RESOLUTION_320x240, DEPTH_16_BPP },
+    { "VI 320x240x32", LOAD_VI, RESOLUTION_320x240, DEPTH_32_BPP },
+    { "VI 640x480x16", LOAD_VI, RESOLUTION_640x480, DEPTH_16_BPP },
+    { "VI 640x480x32", LOAD_VI, RESOLUTION_640x480, DEPTH_32_BPP },
+    { "All",           LOAD_SP_DMA | LOAD_RDP_FILL | LOAD_PI_DMA | LOAD_VI, RESOLUTION_640x480, DEPTH_32_BPP },
+};
+
+#define LOAD_FB_WIDTH            320
+#define LOAD_FB_HEIGHT           240
+#define LOAD_NUM_FILLS           64
+#define LOAD_PI_DMA_SIZE         (256*1024)
+
+static uint8_t *sp_buf, *pi_buf;
+static uint16_t *rdp_fb;
+static uint64_t *rdp_cmds;
+static int rdp_num_cmds;
+
+static void load_init(void) {
+    if (sp_buf) return;
+
+    sp_buf = malloc_uncached(0x800);
+    pi_buf = malloc_uncached(LOAD_PI_DMA_SIZE);
+    rdp_fb = malloc_uncached(LOAD_FB_WIDTH * LOAD_FB_HEIGHT * 2);
+    rdp_cmds = malloc_uncached((LOAD_NUM_FILLS + 4) * sizeof(uint64_t));
+
+    // Full-screen fills in fill mode, which is the fastest way for the RDP
+    // to write to RDRAM.
+    uint64_t *cmd = rdp_cmds;
+    *cmd++ = 0xFF10000000000000ull | ((uint64_t)(LOAD_FB_WIDTH-1) << 32) | PhysicalAddr(rdp_fb);
+    *cmd++ = 0xED00000000000000ull | ((uint64_t)(LOAD_FB_WIDTH << 2) << 12) | (LOAD_FB_HEIGHT << 2);
+    *cmd++ = 0xEF30000000000000ull;
+    *cmd++ = 0xF700000000000000ull | 0x12341234;
+    for (int i=0; i<LOAD_NUM_FILLS; i++)
+        *cmd++ = 0xF600000000000000ull | ((uint64_t)((LOAD_FB_WIDTH-1) << 2) << 44) | ((uint64_t)((LOAD_FB_HEIGHT-1) << 2) << 32);
+    rdp_num_cmds = cmd - rdp_cmds;
+}
+
+static void load_start(int scenario) {
+    uint32_t loads = scenarios[scenario].loads;
+    load_init();
+
+    if (loads & LOAD_VI)
+        display_init(scenarios[scenario].res, scenarios[scenario].bpp, 1, GAMMA_NONE, ANTIALIAS_RESAMPLE);
+
+    if (loads & LOAD_SP_DMA) {
+        rsp_load(&rsp_dmaloop);
+        SP_DMEM[0] = PhysicalAddr(sp_buf);
+        rsp_run_async();
+    }
+
+    if (loads & LOAD_RDP_FILL) {
+        DP_regs[3] = DP_WSTATUS_CLR_XBUS | DP_WSTATUS_CLR_FREEZE | DP_WSTATUS_CLR_FLUSH;
+        DP_regs[0] = PhysicalAddr(rdp_cmds);
+        DP_regs[1] = PhysicalAddr(rdp_cmds + rdp_num_cmds);
+    }
+
+    if (loads & LOAD_PI_DMA) {
+        PI_regs->ram_address = pi_buf;
+        PI_regs->pi_address = 0x10000000;
+        PI_regs->write_length = LOAD_PI_DMA_SIZE-1;
+    }
+}
+
+static void load_stop(int scenario) {
+    uint32_t loads = scenarios[scenario].loads;
+
+    if (loads & LOAD_PI_DMA)
+        while (PI_regs->status & (PI_STATUS_DMA_BUSY | PI_STATUS_IO_BUSY)) {}
+
+    if (loads & LOAD_RDP_FILL)
+        while (DP_regs[3] & (DP_STATUS_PIPE_BUSY | DP_STATUS_DMA_BUSY | DP_STATUS_END_VALID | DP_STATUS_START_VALID)) {}
+
+    if (loads & LOAD_SP_DMA) {
+        *SP_STATUS = SP_WSTATUS_SET_HALT;
+        while (*SP_DMA_BUSY) {}
+    }
+
+    if (loads & LOAD_VI) {
+        display_close();
+        VI_regs->control = 0;
+    }
+}
+
+xcycle_t bench_contention(benchmark_t *b) {
+    int scenario = b->args[0];
+    xcycle_t (*func)(benchmark_t *b) = loaded_benchs[b->args[1]].func;
+
+    load_start(scenario);
+    xcycle_t t = func(b);
+    load_stop(scenario);
+    return t;
+}
+
+// Register every benchmark under every load scenario. Points are not graded;
+// compare them with the same benchmark on an idle bus.
+__attribute__((constructor))
+static void bench_contention_register(void) {
+    char name[48];
+
+    for (int s=0; s < sizeof(scenarios)/sizeof(scenarios[0]); s++) {
+        for (int i=0; i < sizeof(loaded_benchs)/sizeof(loaded_benchs[0]); i++) {
+            snprintf(name, sizeof(name), "%s @ %s", loaded_benchs[i].name, scenarios[s].name);
+            benchmark_t *b = bench_new(bench_contention, CAT_CONTENTION, name,
+                loaded_benchs[i].qty, UNIT_BYTES, CYCLE_CPU, 0);
+            b->args[0] = s;
+            b->args[1] = i;
+        }
+    }
+}
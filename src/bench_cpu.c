@@ -0,0 +1,181 @@
+#include "systembench.h"
+
+// Time a chain of copies of an asm statement, as the difference between a
+// long and a short chain, so that the TIMEIT instrumentation cancels out.
+// The result is the cost of a single copy. Make the copies depend on each
+// other to measure latency.
+#define CHAIN_SHORT              16
+#define CHAIN_LONG               48
+
+#define CHAIN_STR_(n)            #n
+#define CHAIN_STR(n)             CHAIN_STR_(n)
+
+#define CHAIN_ASM(n, op, ...) \
+    asm volatile(".set noreorder\n .rept " CHAIN_STR(n) "\n" op "\n .endr\n .set reorder\n" __VA_ARGS__)
+
+#define TIMEIT_CHAIN(op, ...) ({ \
+    xcycle_t __t = SAMPLE_MULTI(20, chain_diff( \
+        TIMEIT(({ }), ({ CHAIN_ASM(CHAIN_LONG, op, __VA_ARGS__); })), \
+        TIMEIT(({ }), ({ CHAIN_ASM(CHAIN_SHORT, op, __VA_ARGS__); })))); \
+    timeit_per_iter(__t, CHAIN_LONG - CHAIN_SHORT); \
+})
+
+static inline xcycle_t chain_diff(xcycle_t t_long, xcycle_t t_short) {
+    return t_long > t_short ? t_long - t_short : 0;
+}
+
+// Expected values are the latencies documented in the VR4300 user manual.
+
+// Multiplications are chained through LO: the result is the latency of the
+// multiplication plus the single cycle of MFLO. Squares of an odd number stay
+// odd, so the operand never becomes zero.
+xcycle_t bench_cpu_mult(benchmark_t *b) {
+    uint32_t x = 3;
+    return TIMEIT_CHAIN("mult %0, %0\n mflo %0", : "+r"(x) : : "hi", "lo");
+}
+BENCHMARK(bench_cpu_mult, CAT_CPU, "CPU MULT+MFLO", 1, UNIT_OPS, CYCLE_CPU, XCYCLE_FROM_CPU(5+1));
+
+xcycle_t bench_cpu_dmult(benchmark_t *b) {
+    uint64_t x = 3;
+    return TIMEIT_CHAIN("dmult %0, %0\n mflo %0", : "+r"(x) : : "hi", "lo");
+}
+BENCHMARK(bench_cpu_dmult, CAT_CPU, "CPU DMULT+MFLO", 1, UNIT_OPS, CYCLE_CPU, XCYCLE_FROM_CPU(8+1));
+
+// The 3-operand form with $zero as destination is the raw instruction,
+// without the divide-by-zero checks of the assembler macro.
+xcycle_t bench_cpu_div(benchmark_t *b) {
+    uint32_t x = 1000, y = 3;
+    return TIMEIT_CHAIN("div $zero, %0, %1", : : "r"(x), "r"(y) : "hi", "lo");
+}
+BENCHMARK(bench_cpu_div, CAT_CPU, "CPU DIV", 1, UNIT_OPS, CYCLE_CPU, XCYCLE_FROM_CPU(37));
+
+xcycle_t bench_cpu_ddiv(benchmark_t *b) {
+    uint64_t x = 1000, y = 3;
+    return TIMEIT_CHAIN("ddiv $zero, %0, %1", : : "r"(x), "r"(y) : "hi", "lo");
+}
+BENCHMARK(bench_cpu_ddiv, CAT_CPU, "CPU DDIV", 1, UNIT_OPS, CYCLE_CPU, XCYCLE_FROM_CPU(69));
+
+xcycle_t bench_cpu_lw(benchmark_t *b) {
+    uint32_t *p = (uint32_t *)rambuf, x;
+    return TIMEIT_CHAIN("lw %0, 0(%1)", : "=&r"(x) : "r"(p));
+}
+BENCHMARK(bench_cpu_lw, CAT_CPU, "CPU LW", 1, UNIT_OPS, CYCLE_CPU, XCYCLE_FROM_CPU(1));
+
+// Pointer chasing on a word that points to itself: every load uses the
+// result of the previous one.
+xcycle_t bench_cpu_load_use(benchmark_t *b) {
+    uint32_t *p = (uint32_t *)rambuf;
+    *p = (uint32_t)p;
+    return TIMEIT_CHAIN("lw %0, 0(%0)", : "+r"(p));
+}
+BENCHMARK(bench_cpu_load_use, CAT_CPU, "CPU LW load-use", 1, UNIT_OPS, CYCLE_CPU, XCYCLE_FROM_CPU(2));
+
+xcycle_t bench_cpu_lwl_lwr(benchmark_t *b) {
+    uint8_t *p = rambuf;
+    uint32_t x;
+    return TIMEIT_CHAIN("lwl %0, 1(%1)\n lwr %0, 4(%1)", : "=&r"(x) : "r"(p));
+}
+BENCHMARK(bench_cpu_lwl_lwr, CAT_CPU, "CPU LWL+LWR", 1, UNIT_OPS, CYCLE_CPU, XCYCLE_FROM_CPU(2));
+
+// Branches include their delay slot (a nop, or nullified)
+xcycle_t bench_cpu_beq_taken(benchmark_t *b) {
+    return TIMEIT_CHAIN("beq $zero, $zero, 1f\n nop\n 1:");
+}
+BENCHMARK(bench_cpu_beq_taken, CAT_CPU, "CPU BEQ taken", 1, UNIT_OPS, CYCLE_CPU, XCYCLE_FROM_CPU(2));
+
+xcycle_t bench_cpu_beq_not_taken(benchmark_t *b) {
+    uint32_t x = 1;
+    return TIMEIT_CHAIN("beq %0, $zero, 1f\n nop\n 1:", : : "r"(x));
+}
+BENCHMARK(bench_cpu_beq_not_taken, CAT_CPU, "CPU BEQ not taken", 1, UNIT_OPS, CYCLE_CPU, XCYCLE_FROM_CPU(2));
+
+xcycle_t bench_cpu_beql_taken(benchmark_t *b) {
+    return TIMEIT_CHAIN("beql $zero, $zero, 1f\n nop\n 1:");
+}
+BENCHMARK(bench_cpu_beql_taken, CAT_CPU, "CPU BEQL taken", 1, UNIT_OPS, CYCLE_CPU, XCYCLE_FROM_CPU(2));
+
+xcycle_t bench_cpu_beql_not_taken(benchmark_t *b) {
+    uint32_t x = 1;
+    return TIMEIT_CHAIN("beql %0, $zero, 1f\n nop\n 1:", : : "r"(x));
+}
+BENCHMARK(bench_cpu_beql_not_taken, CAT_CPU, "CPU BEQL not taken", 1, UNIT_OPS, CYCLE_CPU, XCYCLE_FROM_CPU(2));
+
+// FPU operations are chained on the same register. Operands are 1.0 so
+// that values stay normalized and never raise unimplemented exceptions.
+#define BENCH_FPU(func, op, type, cycles) \
+    xcycle_t func(benchmark_t *b) { \
+        type x = 1.0, y = 1.0; \
+        return TIMEIT_CHAIN(op " %0, %0, %1", : "+f"(x) : "f"(y)); \
+    } \
+    BENCHMARK(func, CAT_CPU, "CPU " op, 1, UNIT_OPS, CYCLE_CPU, XCYCLE_FROM_CPU(cycles));
+
+BENCH_FPU(bench_cpu_add_s, "add.s", float,  3)
+BENCH_FPU(bench_cpu_add_d, "add.d", double, 3)
+BENCH_FPU(bench_cpu_mul_s, "mul.s", float,  5)
+BENCH_FPU(bench_cpu_mul_d, "mul.d", double, 8)
+BENCH_FPU(bench_cpu_div_s, "div.s", float,  29)
+BENCH_FPU(bench_cpu_div_d, "div.d", double, 58)
+
+xcycle_t bench_cpu_sqrt_s(benchmark_t *b) {
+    float x = 1.0f;
+    return TIMEIT_CHAIN("sqrt.s %0, %0", : "+f"(x));
+}
+BENCHMARK(bench_cpu_sqrt_s, CAT_CPU, "CPU sqrt.s", 1, UNIT_OPS, CYCLE_CPU, XCYCLE_FROM_CPU(29));
+
+xcycle_t bench_cpu_sqrt_d(benchmark_t *b) {
+    double x = 1.0;
+    return TIMEIT_CHAIN("sqrt.d %0, %0", : "+f"(x));
+}
+BENCHMARK(bench_cpu_sqrt_d, CAT_CPU, "CPU sqrt.d", 1, UNIT_OPS, CYCLE_CPU, XCYCLE_FROM_CPU(58));
+
+// Conversions are measured as round trips, so that the register always
+// holds a valid value for the next conversion. The register initially
+// holds the integer 1 (in its low word) where the chain starts from an
+// integer format.
+xcycle_t bench_cpu_cvt_s_w(benchmark_t *b) {
+    union { uint32_t i; float f; } x = { .i = 1 };
+    return TIMEIT_CHAIN("cvt.s.w %0, %0\n cvt.w.s %0, %0", : "+f"(x.f));
+}
+BENCHMARK(bench_cpu_cvt_s_w, CAT_CPU, "CPU cvt.s.w+cvt.w.s", 1, UNIT_OPS, CYCLE_CPU, XCYCLE_FROM_CPU(10));
+
+xcycle_t bench_cpu_cvt_d_w(benchmark_t *b) {
+    union { uint64_t i; double f; } x = { .i = 1 };
+    return TIMEIT_CHAIN("cvt.d.w %0, %0\n cvt.w.d %0, %0", : "+f"(x.f));
+}
+BENCHMARK(bench_cpu_cvt_d_w, CAT_CPU, "CPU cvt.d.w+cvt.w.d", 1, UNIT_OPS, CYCLE_CPU, XCYCLE_FROM_CPU(10));
+
+xcycle_t bench_cpu_cvt_d_s(benchmark_t *b) {
+    double x = 1.0;
+    return TIMEIT_CHAIN("cvt.d.s %0, %0\n cvt.s.d %0, %0", : "+f"(x));
+}
+BENCHMARK(bench_cpu_cvt_d_s, CAT_CPU, "CPU cvt.d.s+cvt.s.d", 1, UNIT_OPS, CYCLE_CPU, XCYCLE_FROM_CPU(3));
+
+xcycle_t bench_cpu_trunc_w_s(benchmark_t *b) {
+    float x = 1.0f;
+    return TIMEIT_CHAIN("trunc.w.s %0, %0\n cvt.s.w %0, %0", : "+f"(x));
+}
+BENCHMARK(bench_cpu_trunc_w_s, CAT_CPU, "CPU trunc.w.s+cvt.s.w", 1, UNIT_OPS, CYCLE_CPU, XCYCLE_FROM_CPU(10));
+
+// A load from an unmapped KUSEG address causes a TLB miss. The handler
+// skips the load, so this times the whole libdragon exception path (the
+// refill vector shares the general handler, which saves the full register
+// block).
+static void tlb_miss_handler(exception_t *ex) {
+    if (ex->code == EXCEPTION_CODE_TLB_LOAD_I_MISS) {
+        ex->regs->epc += 4;
+        return;
+    }
+    exception_default_handler(ex);
+}
+
+xcycle_t bench_cpu_tlb_miss(benchmark_t *b) {
+    uint32_t addr = 0x00001000;
+
+    register_exception_handler(tlb_miss_handler);
+    xcycle_t t = TIMEIT_MULTI(20, ({ }), ({
+        asm volatile(".set noreorder\n lw $zero, 0(%0)\n nop\n .set reorder\n" : : "r"(addr));
+    }));
+    register_exception_handler(exception_default_handler);
+    return t;
+}
+BENCHMARK(bench_cpu_tlb_miss, CAT_CPU, "CPU TLB miss", 1, UNIT_OPS, CYCLE_CPU, 0);
@@ -0,0 +1,228 @@
+#include "systembench.h"
+
+static volatile struct MI_regs_s * const MI_regs = (struct MI_regs_s *)0xa4300000;
+
+#define MI_INTR_SP               0x01
+#define MI_INTR_SI               0x02
+#define MI_INTR_VI               0x08
+#define MI_INTR_PI               0x10
+#define MI_INTR_DP               0x20
+
+#define MI_WMODE_CLR_DP_INTR     0x0800
+#define PI_WSTATUS_CLR_INTR      0x02
+
+typedef enum {
+    IRQ_SP,
+    IRQ_DP,
+    IRQ_SI,
+    IRQ_PI,
+    IRQ_VI,
+    IRQ_TI,
+} irq_src_t;
+
+static const struct {
+    const char *name;
+    uint32_t mi_intr;                       // Bit in MI_INTR / MI_MASK (0 for the timer)
+    void (*set)(int active);                // NULL when enabled by other means
+    void (*reg)(void (*callback)());
+    void (*unreg)(void (*callback)());
+} irq_srcs[] = {
+    [IRQ_SP] = { "SP", MI_INTR_SP, set_SP_interrupt, register_SP_handler, unregister_SP_handler },
+    [IRQ_DP] = { "DP", MI_INTR_DP, set_DP_interrupt, register_DP_handler, unregister_DP_handler },
+    [IRQ_SI] = { "SI", MI_INTR_SI, set_SI_interrupt, register_SI_handler, unregister_SI_handler },
+    [IRQ_PI] = { "PI", MI_INTR_PI, set_PI_interrupt, register_PI_handler, unregister_PI_handler },
+    [IRQ_VI] = { "VI", MI_INTR_VI, NULL,             register_VI_handler, unregister_VI_handler },
+    [IRQ_TI] = { "TI", 0,          set_TI_interrupt, register_TI_handler, unregister_TI_handler },
+};
+
+static volatile bool irq_hit;
+static volatile uint32_t irq_t1;
+static volatile bool si_done;
+static bool irq_was_enabled;
+
+// Registered last, so that it is the first callback to be called
+static void irq_entry(void) {
+    if (!irq_hit) {
+        irq_t1 = TICKS_READ();
+        irq_hit = true;
+    }
+}
+
+static void irq_nop(void) {}
+
+static void si_callback(uint64_t *output, void *ctx) {
+    si_done = true;
+}
+
+// Acknowledge the RCP interrupts left pending by other benchmarks, which
+// poll the hardware with interrupts disabled. Any of them may be unmasked
+// (joybus unmasks SI at startup and asserts on a stray one), so all must be
+// cleared before interrupts are enabled.
+static void irq_ack_all(void) {
+    *SP_STATUS = SP_WSTATUS_CLEAR_INTR;
+    MI_regs->mode = MI_WMODE_CLR_DP_INTR;
+    SI_regs->status = SI_WSTATUS_INTACK;
+    PI_regs->status = PI_WSTATUS_CLR_INTR;
+    VI_regs->cur_line = VI_regs->cur_line;
+}
+
+static bool irq_enabled(irq_src_t src) {
+    if (src == IRQ_TI)
+        return C0_STATUS() & C0_INTERRUPT_TIMER;
+    return MI_regs->mask & irq_srcs[src].mi_intr;
+}
+
+static void irq_begin(irq_src_t src, int callbacks) {
+    irq_ack_all();
+    for (int i=0; i<callbacks; i++)
+        irq_srcs[src].reg(irq_nop);
+    irq_srcs[src].reg(irq_entry);
+
+    irq_was_enabled = irq_enabled(src);
+    if (src == IRQ_VI)
+        display_init(RESOLUTION_320x240, DEPTH_16_BPP, 2, GAMMA_NONE, ANTIALIAS_RESAMPLE);
+    else
+        irq_srcs[src].set(1);
+}
+
+static void irq_end(irq_src_t src, int callbacks) {
+    if (src == IRQ_VI) {
+        display_close();
+        VI_regs->control = 0;
+    } else if (!irq_was_enabled) {
+        irq_srcs[src].set(0);
+    }
+
+    irq_srcs[src].unreg(irq_entry);
+    for (int i=0; i<callbacks; i++)
+        irq_srcs[src].unreg(irq_nop);
+}
+
+// Start an operation that triggers the interrupt
+static void irq_raise(irq_src_t src) {
+    static uint64_t dp_sync_full __attribute__((aligned(8))) = 0xE900000000000000ull;
+    static uint64_t si_block[JOYBUS_BLOCK_DWORDS] __attribute__((aligned(8))) = {
+        0xfe00000000000000ull, 0, 0, 0, 0, 0, 0, 1,
+    };
+
+    switch (src) {
+    case IRQ_SP:
+        *SP_STATUS = SP_WSTATUS_SET_INTR;
+        break;
+    case IRQ_DP:
+        data_cache_hit_writeback(&dp_sync_full, sizeof(dp_sync_full));
+        while (DP_regs[3] & (DP_STATUS_START_VALID | DP_STATUS_END_VALID)) {}
+        DP_regs[3] = DP_WSTATUS_CLR_XBUS | DP_WSTATUS_CLR_FREEZE | DP_WSTATUS_CLR_FLUSH;
+        DP_regs[0] = PhysicalAddr(&dp_sync_full);
+        DP_regs[1] = PhysicalAddr(&dp_sync_full + 1);
+        break;
+    case IRQ_SI:
+        // Go through joybus, as its SI handler asserts on unexpected interrupts
+        si_done = false;
+        joybus_exec_async(si_block, si_callback, NULL);
+        break;
+    case IRQ_PI:
+        PI_regs->ram_address = rambuf;
+        PI_regs->pi_address = 0x10000000;
+        PI_regs->write_length = 8-1;
+        break;
+    case IRQ_VI:
+        // Acknowledge the pending one, and wait for the next frame
+        VI_regs->cur_line = VI_regs->cur_line;
+        break;
+    case IRQ_TI:
+        C0_WRITE_COMPARE(C0_COUNT() + 64);
+        break;
+    }
+}
+
+static bool irq_pending(irq_src_t src) {
+    if (src == IRQ_TI)
+        return C0_CAUSE() & C0_INTERRUPT_TIMER;
+    return MI_regs->intr & irq_srcs[src].mi_intr;
+}
+
+// Raise an interrupt with interrupts disabled, wait until it is pending, and
+// then enable interrupts. Return the time from enable_interrupts() to the
+// first callback, or to the return of enable_interrupts() if total is set.
+static xcycle_t irq_sample(irq_src_t src, bool total) {
+    irq_hit = false;
+    irq_raise(src);
+    while (!irq_pending(src)) {}
+
+    uint32_t t0 = TICKS_READ();
+    enable_interrupts();
+    uint32_t t2 = TICKS_READ();
+    disable_interrupts();
+
+    // Let joybus complete the transfer, which triggers a second interrupt
+    if (src == IRQ_SI) {
+        enable_interrupts();
+        while (!si_done) {}
+        disable_interrupts();
+    }
+
+    assertf(irq_hit, "%s interrupt not dispatched", irq_srcs[src].name);
+    return XCYCLE_FROM_COP0(TICKS_DISTANCE(t0, total ? t2 : irq_t1));
+}
+
+// args[0] is the interrupt source, args[1] is 1 to time the full round
+// trip. qty is the number of additional (empty) callbacks registered on the
+// same interrupt.
+xcycle_t bench_irq(benchmark_t *b) {
+    irq_src_t src = b->args[0];
+    bool total = b->args[1];
+
+    // Once timer_init() has run (eg. for the profiler), timer.c owns the
+    // compare register, and the test would break its schedule.
+    if (src == IRQ_TI && irq_enabled(IRQ_TI))
+        return 0;
+
+    irq_begin(src, b->qty);
+    xcycle_t t = SAMPLE_MULTI(20, irq_sample(src, total));
+    irq_end(src, b->qty);
+    return t;
+}
+
+// args[0] is 1 to start from enabled interrupts (outermost pair), 0 for a
+// nested pair.
+xcycle_t bench_irq_disable_enable(benchmark_t *b) {
+    bool outer = b->args[0];
+
+    if (outer) {
+        irq_ack_all();
+        enable_interrupts();
+    }
+    xcycle_t t = TIMEIT_MULTI(50, ({ }), ({ disable_interrupts(); enable_interrupts(); }));
+    if (outer) disable_interrupts();
+    return t;
+}
+
+// Register handler entry latency and round trip for every source, round
+// trip of the SP interrupt as the callback list grows, and the cost of a
+// disable/enable pair. Points are not graded.
+__attribute__((constructor))
+static void bench_irq_register(void) {
+    char name[32];
+
+    for (irq_src_t src=IRQ_SP; src <= IRQ_TI; src++) {
+        for (int total=0; total <= 1; total++) {
+            snprintf(name, sizeof(name), "IRQ %s %s", irq_srcs[src].name, total ? "total" : "entry");
+            benchmark_t *b = bench_new(bench_irq, CAT_IRQ, name, 0, UNIT_OPS, CYCLE_COP0, 0);
+            b->args[0] = src;
+            b->args[1] = total;
+        }
+    }
+
+    for (int n=1; n <= 32; n *= 2) {
+        benchmark_t *b = bench_new(bench_irq, CAT_IRQ, "IRQ SP callbacks", n, UNIT_OPS, CYCLE_COP0, 0);
+        b->args[0] = IRQ_SP;
+        b->args[1] = 1;
+    }
+
+    for (int outer=0; outer <= 1; outer++) {
+        benchmark_t *b = bench_new(bench_irq_disable_enable, CAT_IRQ,
+            outer ? "IRQ dis+en outer" : "IRQ dis+en nested", 1, UNIT_OPS, CYCLE_CPU, 0);
+        b->args[0] = outer;
+    }
+}
@@ -0,0 +1,231 @@
+#include "systembench.h"
+
+static void joybus_write(uint64_t *in) {
+    SI_regs->status = SI_WSTATUS_INTACK;
+    SI_regs->DRAM_addr = in;
+    SI_regs->PIF_addr_write = PIF_RAM;
+    while (SI_regs->status & (SI_STATUS_DMA_BUSY | SI_STATUS_IO_BUSY)) {}
+    SI_regs->status = SI_WSTATUS_INTACK;
+}
+static void joybus_read(uint64_t *out) {
+    SI_regs->DRAM_addr = out;
+    SI_regs->PIF_addr_read = PIF_RAM;
+    while (SI_regs->status & (SI_STATUS_DMA_BUSY | SI_STATUS_IO_BUSY)) {}
+}
+
+xcycle_t bench_joybus_empty0(benchmark_t *b) {
+    uint64_t *buf = UncachedAddr(rambuf);
+    uint64_t *out = UncachedAddr(rambuf+64);
+
+    return TIMEIT_MULTI(50, ({ 
+        buf[0] = 0xfe00000000000000;
+        buf[1] = 0;
+        buf[2] = 0;
+        buf[3] = 0;
+        buf[4] = 0;
+        buf[5] = 0;
+        buf[6] = 0;
+        buf[7] = 1;       
+        joybus_write(buf); 
+    }), ({ joybus_read(out); }));
+}
+BENCHMARK(bench_joybus_empty0, CAT_JOY, "JOY: Empty 0B", 64, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(15030));
+
+xcycle_t bench_joybus_empty0b(benchmark_t *b) {
+    uint64_t *buf = UncachedAddr(rambuf);
+    uint64_t *out = UncachedAddr(rambuf+64);
+
+    return TIMEIT_MULTI(50, ({ 
+        buf[0] = 0x00fe000000000000;
+        buf[1] = 0;
+        buf[2] = 0;
+        buf[3] = 0;
+        buf[4] = 0;
+        buf[5] = 0;
+        buf[6] = 0;
+        buf[7] = 1;       
+        joybus_write(buf); 
+    }), ({ joybus_read(out); }));
+}
+BENCHMARK(bench_joybus_empty0b, CAT_JOY, "JOY: Empty 1B", 64, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(16424));
+
+xcycle_t bench_joybus_empty0c(benchmark_t *b) {
+    uint64_t *buf = UncachedAddr(rambuf);
+    uint64_t *out = UncachedAddr(rambuf+64);
+
+    return TIMEIT_MULTI(50, ({ 
+        buf[0] = 0x00000000fe000000;
+        buf[1] = 0;
+        buf[2] = 0;
+        buf[3] = 0;
+        buf[4] = 0;
+        buf[5] = 0;
+        buf[6] = 0;
+        buf[7] = 1;       
+        joybus_write(buf); 
+    }), ({ joybus_read(out); }));
+}
+BENCHMARK(bench_joybus_empty0c, CAT_JOY, "JOY: Empty 4B", 64, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(20644));
+
+xcycle_t bench_joybus_empty1(benchmark_t *b) {
+    uint64_t *buf = UncachedAddr(rambuf);
+    uint64_t *out = UncachedAddr(rambuf+64);
+
+    return TIMEIT_MULTI(50, ({ 
+        buf[0] = 0;
+        buf[1] = 0xfe00000000000000;
+        buf[2] = 0;
+        buf[3] = 0;
+        buf[4] = 0;
+        buf[5] = 0;
+        buf[6] = 0;
+        buf[7] = 1;       
+        joybus_write(buf); 
+    }), ({ joybus_read(out); }));
+}
+BENCHMARK(bench_joybus_empty1, CAT_JOY, "JOY: Empty 8B", 64, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(21163));
+
+
+xcycle_t bench_joybus_empty4(benchmark_t *b) {
+    uint64_t *buf = UncachedAddr(rambuf);
+    uint64_t *out = UncachedAddr(rambuf+64);
+
+    return TIMEIT_MULTI(50, ({ 
+        buf[0] = 0;
+        buf[1] = 0;
+        buf[2] = 0;
+        buf[3] = 0;
+        buf[4] = 0xfe00000000000000;
+        buf[5] = 0;
+        buf[6] = 0;
+        buf[7] = 1;
+        joybus_write(buf); 
+    }), ({ joybus_read(out); }));
+}
+BENCHMARK(bench_joybus_empty4, CAT_JOY, "JOY: Empty 32B", 64, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(21163));
+
+xcycle_t bench_joybus_empty7(benchmark_t *b) {
+    uint64_t *buf = UncachedAddr(rambuf);
+    uint64_t *out = UncachedAddr(rambuf+64);
+
+    return TIMEIT_MULTI(50, ({ 
+        buf[0] = 0;
+        buf[1] = 0;
+        buf[2] = 0;
+        buf[3] = 0;
+        buf[4] = 0;
+        buf[5] = 0;
+        buf[6] = 0;
+        buf[7] = 0xfe00000000000001;       
+        joybus_write(buf); 
+    }), ({ joybus_read(out); }));
+}
+BENCHMARK(bench_joybus_empty7, CAT_JOY, "JOY: Empty 56B", 64, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(21170));
+
+xcycle_t bench_joybus_empty7e(benchmark_t *b) {
+    uint64_t *buf = UncachedAddr(rambuf);
+    uint64_t *out = UncachedAddr(rambuf+64);
+
+    return TIMEIT_MULTI(50, ({ 
+        buf[0] = 0;
+        buf[1] = 0;
+        buf[2] = 0;
+        buf[3] = 0;
+        buf[4] = 0;
+        buf[5] = 0;
+        buf[6] = 0;
+        buf[7] = 0x000000000000fe01;       
+        joybus_write(buf); 
+    }), ({ joybus_read(out); }));
+}
+BENCHMARK(bench_joybus_empty7e, CAT_JOY, "JOY: Empty 63B", 64, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(21178));
+
+xcycle_t bench_joybus_1j(benchmark_t *b) {
+    uint64_t *buf = UncachedAddr(rambuf);
+    uint64_t *out = UncachedAddr(rambuf+64);
+
+    return TIMEIT_MULTI(50, ({ 
+        buf[0] = 0xff010401ffffffff;
+        buf[1] = 0xfe00000000000000;
+        buf[2] = 0;
+        buf[3] = 0;
+        buf[4] = 0;
+        buf[5] = 0;
+        buf[6] = 0;
+        buf[7] = 1;       
+        joybus_write(buf); 
+    }), ({ joybus_read(out); }));
+}
+BENCHMARK(bench_joybus_1j, CAT_JOY, "JOY: 1J", 64, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(37987));
+
+xcycle_t bench_joybus_2j(benchmark_t *b) {
+    uint64_t *buf = UncachedAddr(rambuf);
+    uint64_t *out = UncachedAddr(rambuf+64);
+
+    return TIMEIT_MULTI(50, ({ 
+        buf[0] = 0xff010401ffffffff;
+        buf[1] = 0xff010401ffffffff;
+        buf[2] = 0xfe00000000000000;
+        buf[3] = 0;
+        buf[4] = 0;
+        buf[5] = 0;
+        buf[6] = 0;
+        buf[7] = 1;       
+        joybus_write(buf); 
+    }), ({ joybus_read(out); }));
+}
+BENCHMARK(bench_joybus_2j, CAT_JOY, "JOY: 2J", 64, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(57972));
+
+xcycle_t bench_joybus_3j(benchmark_t *b) {
+    uint64_t *buf = UncachedAddr(rambuf);
+    uint64_t *out = UncachedAddr(rambuf+64);
+
+    return TIMEIT_MULTI(50, ({ 
+        buf[0] = 0xff010401ffffffff;
+        buf[1] = 0xff010401ffffffff;
+        buf[2] = 0xff010401ffffffff;
+        buf[3] = 0xfe00000000000000;
+        buf[4] = 0;
+        buf[5] = 0;
+        buf[6] = 0;
+        buf[7] = 1;       
+        joybus_write(buf); 
+    }), ({ joybus_read(out); }));
+}
+BENCHMARK(bench_joybus_3j, CAT_JOY, "JOY: 3J", 64, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(77924));
+
+xcycle_t bench_joybus_4j(benchmark_t *b) {
+    uint64_t *buf = UncachedAddr(rambuf);
+    uint64_t *out = UncachedAddr(rambuf+64);
+
+    return TIMEIT_MULTI(50, ({ 
+        buf[0] = 0xff010401ffffffff;
+        buf[1] = 0xff010401ffffffff;
+        buf[2] = 0xff010401ffffffff;
+        buf[3] = 0xff010401ffffffff;
+        buf[4] = 0xfe00000000000000;
+        buf[5] = 0;
+        buf[6] = 0;
+        buf[7] = 1;       
+        joybus_write(buf); 
+    }), ({ joybus_read(out); }));
+}
+BENCHMARK(bench_joybus_4j, CAT_JOY, "JOY: 4J", 64, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(97890));
+
+xcycle_t bench_joybus_access(benchmark_t *b) {
+    uint64_t *buf = UncachedAddr(rambuf);
+    uint64_t *out = UncachedAddr(rambuf+64);
+
+    return TIMEIT_MULTI(50, ({ 
+        buf[0] = 0xff010300ffffffff;
+        buf[1] = 0xfe00000000000000;
+        buf[2] = 0;
+        buf[3] = 0;
+        buf[4] = 0;
+        buf[5] = 0;
+        buf[6] = 0;
+        buf[7] = 1;       
+        joybus_write(buf); 
+    }), ({ joybus_read(out); }));
+}
+BENCHMARK(bench_joybus_access, CAT_JOY, "JOY: Accessory", 64, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(36834));
@@ -0,0 +1,102 @@
+#include "systembench.h"
+
+// Gaps between two consecutive reads of the COP0 count in the polling loop
+// longer than this are attributed to interrupt handlers.
+#define JOYA_IRQ_GAP_TICKS       20
+
+typedef enum {
+    JOYA_SUBMIT,            // CPU time spent in joybus_exec_async()
+    JOYA_IRQ,               // CPU time spent in the SI interrupt handlers
+    JOYA_FREE,              // CPU time left to the caller while waiting
+    JOYA_LATENCY,           // From submission to the completion callback
+} joya_metric_t;
+
+static const char *joya_metric_names[] = { "submit", "irq", "free", "latency" };
+
+// Same blocks of the polling JOY benchmarks, plus the status of all
+// accessories, that is polled together with the buttons every frame.
+static const struct {
+    const char *name;
+    uint64_t block[JOYBUS_BLOCK_DWORDS];
+} joya_blocks[] = {
+    { "Empty", { 0xfe00000000000000, 0, 0, 0, 0, 0, 0, 1 } },
+    { "1J",    { 0xff010401ffffffff, 0xfe00000000000000, 0, 0, 0, 0, 0, 1 } },
+    { "4J",    { 0xff010401ffffffff, 0xff010401ffffffff, 0xff010401ffffffff,
+                 0xff010401ffffffff, 0xfe00000000000000, 0, 0, 1 } },
+    { "4 Acc", { 0xff010300ffffffff, 0xff010300ffffffff, 0xff010300ffffffff,
+                 0xff010300ffffffff, 0xfe00000000000000, 0, 0, 1 } },
+};
+
+static volatile bool joya_done;
+static volatile uint32_t joya_t_done;
+
+static void joya_callback(uint64_t *output, void *ctx) {
+    joya_t_done = TICKS_READ();
+    joya_done = true;
+}
+
+// Run a joybus exchange with interrupts enabled, busy-looping on the COP0
+// count until the completion callback is called, and return the requested
+// metric. Time not spent in the loop is time taken by the interrupts.
+static xcycle_t joya_sample(const uint64_t *block, joya_metric_t metric) {
+    uint32_t stolen = 0;
+
+    joya_done = false;
+    enable_interrupts();
+
+    uint32_t t0 = TICKS_READ();
+    joybus_exec_async(block, joya_callback, NULL);
+    uint32_t t1 = TICKS_READ();
+
+    uint32_t prev = t1, now;
+    do {
+        now = TICKS_READ();
+        if (TICKS_DISTANCE(prev, now) > JOYA_IRQ_GAP_TICKS)
+            stolen += TICKS_DISTANCE(prev, now);
+        prev = now;
+    } while (!joya_done);
+
+    // Account for the return from the last interrupt
+    now = TICKS_READ();
+    if (TICKS_DISTANCE(prev, now) > JOYA_IRQ_GAP_TICKS)
+        stolen += TICKS_DISTANCE(prev, now);
+
+    disable_interrupts();
+
+    switch (metric) {
+    case JOYA_SUBMIT:  return XCYCLE_FROM_COP0(TICKS_DISTANCE(t0, t1));
+    case JOYA_IRQ:     return XCYCLE_FROM_COP0(stolen);
+    case JOYA_FREE:    return XCYCLE_FROM_COP0(TICKS_DISTANCE(t1, now) - stolen);
+    case JOYA_LATENCY: return XCYCLE_FROM_COP0(TICKS_DISTANCE(t0, joya_t_done));
+    }
+    return 0;
+}
+
+// args[0] is the block, args[1] the metric
+xcycle_t bench_joybus_async(benchmark_t *b) {
+    const uint64_t *block = joya_blocks[b->args[0]].block;
+    joya_metric_t metric = b->args[1];
+
+    // The polling benchmarks leave the SI interrupt pending, which would be
+    // taken by joybus as the completion of our first write.
+    SI_regs->status = SI_WSTATUS_INTACK;
+
+    return SAMPLE_MULTI(20, joya_sample(block, metric));
+}
+
+// Register every metric for every block. Points are not graded; compare
+// latency with the polling JOY benchmarks, and free with latency.
+__attribute__((constructor))
+static void bench_joybus_async_register(void) {
+    char name[32];
+
+    for (int i=0; i < sizeof(joya_blocks)/sizeof(joya_blocks[0]); i++) {
+        for (joya_metric_t m=JOYA_SUBMIT; m <= JOYA_LATENCY; m++) {
+            snprintf(name, sizeof(name), "JOYA: %s %s", joya_blocks[i].name, joya_metric_names[m]);
+            benchmark_t *b = bench_new(bench_joybus_async, CAT_JOY_ASYNC, name,
+                1, UNIT_OPS, CYCLE_COP0, 0);
+            b->args[0] = i;
+            b->args[1] = m;
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#include "systembench.h"
+
+// PI domain 1 timing registers: latency, pulse width, page size, release
+static volatile uint32_t * const PI_dom1 = (uint32_t *)0xa4600014;
+
+// Domain 1 timings used by the sweep. The first entry keeps whatever IPL3
+// programmed from the ROM header, the second is a fast setting commonly
+// used by flashcarts.
+static const struct {
+    const char *name;
+    uint32_t lat, pwd, pgs, rls;
+} pi_timings[] = {
+    { "boot" },
+    { "fast", 0x05, 0x0C, 0x0D, 0x02 },
+};
+
+#define PI_SWEEP_MAX_MISALIGN    7
+
+xcycle_t bench_pidma_sweep(benchmark_t *b) {
+    int misalign = b->args[0];
+    int timing = b->args[1];
+
+    uint32_t saved[4];
+    for (int i=0;i<4;i++) saved[i] = PI_dom1[i];
+    if (timing) {
+        PI_dom1[0] = pi_timings[timing].lat;
+        PI_dom1[1] = pi_timings[timing].pwd;
+        PI_dom1[2] = pi_timings[timing].pgs;
+        PI_dom1[3] = pi_timings[timing].rls;
+    }
+
+    xcycle_t t = TIMEIT_WHILE_MULTI(10, ({
+        PI_regs->ram_address = rambuf + misalign;
+        PI_regs->pi_address = 0x10000000;
+    }), ({
+        PI_regs->write_length = b->qty-1;
+    }), ({
+        PI_regs->status & (PI_STATUS_DMA_BUSY | PI_STATUS_IO_BUSY);
+    }));
+
+    for (int i=0;i<4;i++) PI_dom1[i] = saved[i];
+    return t;
+}
+
+// Register one point per transfer size (2 bytes to 1 MiB), RDRAM misalignment
+// (0-7, boot timing only) and domain 1 timing (aligned only). Points are not
+// graded: the interesting output is the bandwidth curve.
+__attribute__((constructor))
+static void bench_pidma_sweep_register(void) {
+    char name[32];
+
+    for (int timing=0; timing < sizeof(pi_timings)/sizeof(pi_timings[0]); timing++) {
+        int max_misalign = timing ? 0 : PI_SWEEP_MAX_MISALIGN;
+        for (int misalign=0; misalign <= max_misalign; misalign++) {
+            for (int size=2; size <= 1024*1024; size *= 2) {
+                if (size + misalign > sizeof(rambuf)) continue;
+                snprintf(name, sizeof(name), "PI DMA %s +%d", pi_timings[timing].name, misalign);
+                benchmark_t *b = bench_new(bench_pidma_sweep, CAT_PI_SWEEP, name,
+                    size, UNIT_BYTES, CYCLE_RCP, 0);
+                b->args[0] = misalign;
+                b->args[1] = timing;
+            }
+        }
+    }
+}
@@ -0,0 +1,162 @@
+#include "systembench.h"
+
+xcycle_t bench_rcp_io_r(benchmark_t *b) {
+    return TIMEIT_MULTI(50, ({ }), ({ (void)VI_regs->control; }));
+}
+BENCHMARK(bench_rcp_io_r, CAT_RCP, "RCP I/O R", 1, UNIT_BYTES, CYCLE_CPU, XCYCLE_FROM_CPU(24));
+
+// Stores are posted to the CPU write buffer, so timing a store alone only
+// measures how long it takes to queue it. An uncached load cannot complete
+// before the pending stores have been accepted by the RCP, so each store is
+// followed by a read of MI_VERSION, and the cost of the read alone is
+// subtracted.
+static volatile uint32_t * const WB_DRAIN = (uint32_t *)0xA4300004;
+
+#define IO_W_STORES              8
+
+typedef enum {
+    IO_W_RCP,               // DP_STATUS (writing 0 does not change anything)
+    IO_W_PI_ROM,            // Cartridge ROM, through the PI
+    IO_W_RDRAM,             // Uncached RDRAM
+} io_w_target_t;
+
+typedef enum {
+    IO_W_SINGLE,            // A single store
+    IO_W_B2B,               // IO_W_STORES back-to-back stores, per store (not on the PI)
+    IO_W_RAW,               // A store followed by a load from the same address
+} io_w_test_t;
+
+static volatile uint32_t *io_w_addr(io_w_target_t target) {
+    switch (target) {
+    case IO_W_RCP:    return &DP_regs[3];
+    case IO_W_PI_ROM: return (volatile uint32_t*)0xB0000000;
+    default:          return (volatile uint32_t*)UncachedAddr(rambuf);
+    }
+}
+
+// PI writes are not accepted while a previous one is in progress
+static void io_w_idle(void) {
+    while (PI_regs->status & (PI_STATUS_DMA_BUSY | PI_STATUS_IO_BUSY)) {}
+}
+
+static xcycle_t io_w_sample(volatile uint32_t *addr, io_w_test_t test) {
+    xcycle_t drain = TIMEIT(io_w_idle(), ({ (void)*WB_DRAIN; }));
+
+    switch (test) {
+    case IO_W_SINGLE:
+        return timeit_sub(TIMEIT(io_w_idle(), ({ *addr = 0; (void)*WB_DRAIN; })), drain);
+    case IO_W_B2B:
+        return timeit_sub(TIMEIT(io_w_idle(), ({
+            for (int i=0; i<IO_W_STORES; i++)
+                *addr = 0;
+            (void)*WB_DRAIN;
+        })), drain);
+    default:
+        return TIMEIT(io_w_idle(), ({ *addr = 0; (void)*addr; }));
+    }
+}
+
+// args[0] is the target, args[1] the test
+xcycle_t bench_io_w(benchmark_t *b) {
+    volatile uint32_t *addr = io_w_addr(b->args[0]);
+    io_w_test_t test = b->args[1];
+
+    xcycle_t t = SAMPLE_MULTI(50, io_w_sample(addr, test));
+    return test == IO_W_B2B ? timeit_per_iter(t, IO_W_STORES) : t;
+}
+
+// Register every test on RCP registers, PI ROM space and uncached RDRAM, in
+// their own category so that the default report is unchanged. Back-to-back
+// stores are not run on the PI, which drops a write while one is in progress.
+// Points are not graded; compare them with the matching read benchmarks.
+__attribute__((constructor))
+static void bench_io_w_register(void) {
+    static const char *targets[] = {
+        [IO_W_RCP]    = "RCP I/O",
+        [IO_W_PI_ROM] = "PI ROM",
+        [IO_W_RDRAM]  = "RDRAM U32",
+    };
+    static const char *tests[] = { "W", "W b2b", "RAW" };
+    char name[32];
+
+    for (io_w_target_t target=IO_W_RCP; target <= IO_W_RDRAM; target++) {
+        for (io_w_test_t test=IO_W_SINGLE; test <= IO_W_RAW; test++) {
+            if (target == IO_W_PI_ROM && test == IO_W_B2B)
+                continue;
+            snprintf(name, sizeof(name), "%s %s", targets[target], tests[test]);
+            benchmark_t *b = bench_new(bench_io_w, CAT_IO_W, name,
+                4, UNIT_BYTES, CYCLE_CPU, 0);
+            b->args[0] = target;
+            b->args[1] = test;
+        }
+    }
+}
+
+xcycle_t bench_pidma(benchmark_t* b) {
+    return TIMEIT_WHILE_MULTI(10, ({
+        PI_regs->ram_address = rambuf;
+        PI_regs->pi_address = 0x10000000;
+    }), ({
+        PI_regs->write_length = b->qty-1;        
+    }), ({
+        PI_regs->status & (PI_STATUS_DMA_BUSY | PI_STATUS_IO_BUSY);
+    }));
+}
+BENCHMARK(bench_pidma, CAT_PI, "PI DMA", 8, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(193));
+BENCHMARK(bench_pidma, CAT_PI, "PI DMA", 128, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(1591));
+BENCHMARK(bench_pidma, CAT_PI, "PI DMA", 1024, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(12168));
+BENCHMARK(bench_pidma, CAT_PI, "PI DMA", 64*1024, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(777807));
+
+xcycle_t bench_piior(benchmark_t* b) {
+    volatile uint32_t *ROM = (volatile uint32_t*)0xB0000000;
+    return TIMEIT_MULTI(50, ({ }), ({ (void)*ROM; }));
+}
+BENCHMARK(bench_piior, CAT_PI, "PI I/O R", 4, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(144));
+
+xcycle_t bench_piiow(benchmark_t* b) {
+    volatile uint32_t *ROM = (volatile uint32_t*)0xB0000000;
+    return TIMEIT_WHILE_MULTI(50, ({ }), ({ 
+        ROM[0] = 0;
+    }), ({  
+        PI_regs->status & (PI_STATUS_DMA_BUSY | PI_STATUS_IO_BUSY);
+    }));
+}
+BENCHMARK(bench_piiow, CAT_PI, "PI I/O W", 4, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(134));
+
+xcycle_t bench_sidmaw_ram(benchmark_t* b) {
+    return TIMEIT_WHILE_MULTI(10, ({
+        SI_regs->DRAM_addr = rambuf;
+    }), ({
+        SI_regs->PIF_addr_write = PIF_RAM;
+    }), ({
+        SI_regs->status & (SI_STATUS_DMA_BUSY | SI_STATUS_IO_BUSY);
+    }));
+}
+BENCHMARK(bench_sidmaw_ram, CAT_SI, "SI DMA W RAM", 64, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(4065));
+
+xcycle_t bench_sidmaw_rom(benchmark_t* b) {
+    return TIMEIT_WHILE_MULTI(10, ({
+        SI_regs->DRAM_addr = rambuf;
+    }), ({
+        SI_regs->PIF_addr_write = PIF_ROM;
+    }), ({
+        SI_regs->status & (SI_STATUS_DMA_BUSY | SI_STATUS_IO_BUSY);
+    }));
+}
+BENCHMARK(bench_sidmaw_rom, CAT_SI, "SI DMA W ROM", 64, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(2144));
+
+xcycle_t bench_siior(benchmark_t* b) {
+    volatile uint32_t *PIF_RAM = (volatile uint32_t*)0xBFC007C0;
+    return TIMEIT_MULTI(50, ({ }), ({ (void)*PIF_RAM; }));
+}
+BENCHMARK(bench_siior, CAT_SI, "SI I/O R", 4, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(1974));
+
+xcycle_t bench_siiow(benchmark_t* b) {
+    volatile uint32_t *PIF_RAM = (volatile uint32_t*)0xBFC007C0;
+    return TIMEIT_WHILE_MULTI(50, ({ }), ({ 
+        PIF_RAM[0] = 0;
+    }), ({  
+        SI_regs->status & (SI_STATUS_DMA_BUSY | SI_STATUS_IO_BUSY);
+    }));
+}
+BENCHMARK(bench_siiow, CAT_SI, "SI I/O W", 4, UNIT_BYTES, CYCLE_RCP, XCYCLE_FROM_RCP(2158));
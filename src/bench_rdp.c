@@ -0,0 +1,206 @@
+#include <stdlib.h>
+#include "systembench.h"
+
+// Render target of all RDP benchmarks
+#define RDP_FB_WIDTH             320
+#define RDP_FB_HEIGHT            240
+
+// Number of primitives drawn (or textures loaded) in each sample
+#define RDP_BENCH_PRIMS          8
+
+// DP counter registers. Samples are taken from the RDP-side counters, so
+// that the CPU time spent by rdp.c to build the commands is not included.
+#define DP_PIPE_BUSY_CTR         6
+#define DP_TMEM_CTR              7
+
+typedef enum {
+    RDP_FILL,
+    RDP_1CYCLE,
+    RDP_2CYCLE,
+    RDP_COPY,
+} rdp_mode_t;
+
+typedef enum {
+    RDP_TEST_RECT,
+    RDP_TEST_TRI,
+    RDP_TEST_TEXRECT,
+    RDP_TEST_LOAD,
+} rdp_test_t;
+
+static const char *rdp_mode_names[] = { "FILL", "1CYC", "2CYC", "COPY" };
+
+static sprite_t *sprite_new(int width, int height, int bitdepth) {
+    int size = width * height * bitdepth;
+    sprite_t *s = malloc(sizeof(sprite_t) + size);
+    s->width = width;
+    s->height = height;
+    s->bitdepth = bitdepth;
+    s->format = 0;
+    s->hslices = 1;
+    s->vslices = 1;
+    memset(s->data, 0x5A, size);
+    data_cache_hit_writeback(s->data, size);
+    return s;
+}
+
+static void rdp_begin(void) {
+    display_init(RESOLUTION_320x240, DEPTH_16_BPP, 2, GAMMA_NONE, ANTIALIAS_RESAMPLE);
+    rdp_init();
+    rdp_attach_display(display_lock());
+    rdp_set_default_clipping();
+
+    // Textures are written back once at creation, so that each load only
+    // costs RDP time.
+    rdp_set_texture_flush(FLUSH_STRATEGY_NONE);
+}
+
+static void rdp_end(void) {
+    rdp_set_texture_flush(FLUSH_STRATEGY_AUTOMATIC);
+    rdp_close();
+    display_close();
+    VI_regs->control = 0;
+}
+
+// Wait for the RDP to process all the commands sent so far.
+static void rdp_idle(void) {
+    rdp_sync(SYNC_FULL);
+    while (DP_regs[3] & (DP_STATUS_PIPE_BUSY | DP_STATUS_DMA_BUSY | DP_STATUS_END_VALID | DP_STATUS_START_VALID)) {}
+}
+
+// rdp.c has no helper for 2-cycle mode, so send SET_OTHER_MODES directly,
+// with the same blender setup as rdp_enable_blend_fill in both cycles.
+static void rdp_enable_blend_fill_2cycle(void) {
+    static uint64_t cmd __attribute__((aligned(8)));
+    cmd = 0xEF1000FFA0000000ull;
+    data_cache_hit_writeback(&cmd, sizeof(cmd));
+
+    while (DP_regs[3] & (DP_STATUS_START_VALID | DP_STATUS_END_VALID)) {}
+    DP_regs[3] = DP_WSTATUS_CLR_XBUS | DP_WSTATUS_CLR_FREEZE | DP_WSTATUS_CLR_FLUSH;
+    DP_regs[0] = PhysicalAddr(&cmd);
+    DP_regs[1] = PhysicalAddr(&cmd + 1);
+}
+
+static void rdp_set_mode(rdp_mode_t mode) {
+    switch (mode) {
+    case RDP_FILL:
+        rdp_enable_primitive_fill();
+        rdp_set_primitive_color(0x12341234);
+        break;
+    case RDP_1CYCLE:
+        rdp_enable_blend_fill();
+        rdp_set_blend_color(0xFFFFFFFF);
+        break;
+    case RDP_2CYCLE:
+        rdp_enable_blend_fill_2cycle();
+        rdp_set_blend_color(0xFFFFFFFF);
+        break;
+    case RDP_COPY:
+        rdp_enable_texture_copy();
+        break;
+    }
+}
+
+// Draw RDP_BENCH_PRIMS primitives (or texture loads) of size w*h, and return
+// the RCP cycles the RDP spent on them. Texture loads are counted with the
+// TMEM counter, everything else with the pipe busy counter.
+static uint32_t rdp_bench_run(rdp_test_t test, rdp_mode_t mode, int w, int h, sprite_t *tex) {
+    // Fill and copy modes include the bottom-right edge of rectangles
+    int incl = (mode == RDP_FILL || mode == RDP_COPY) ? 1 : 0;
+
+    rdp_set_mode(mode);
+    if (test == RDP_TEST_TEXRECT)
+        rdp_load_texture(0, 0, MIRROR_DISABLED, tex);
+    rdp_idle();
+
+    DP_regs[3] = DP_WSTATUS_CLR_TMEM_CTR | DP_WSTATUS_CLR_PIPE_CTR | DP_WSTATUS_CLR_CMD_CTR | DP_WSTATUS_CLR_CLOCK_CTR;
+    for (int i=0; i<RDP_BENCH_PRIMS; i++) {
+        switch (test) {
+        case RDP_TEST_RECT:
+            rdp_draw_filled_rectangle(0, 0, w-incl, h-incl);
+            break;
+        case RDP_TEST_TRI:
+            rdp_draw_filled_triangle(0, 0, w, 0, 0, h);
+            break;
+        case RDP_TEST_TEXRECT:
+            rdp_draw_textured_rectangle(0, 0, 0, w-1, h-1, MIRROR_DISABLED);
+            break;
+        case RDP_TEST_LOAD:
+            rdp_load_texture(0, 0, MIRROR_DISABLED, tex);
+            break;
+        }
+    }
+    rdp_idle();
+
+    return DP_regs[test == RDP_TEST_LOAD ? DP_TMEM_CTR : DP_PIPE_BUSY_CTR] & 0xFFFFFF;
+}
+
+// args[0] is the test, args[1] the mode, args[2] and args[3] the primitive
+// size. Texture loads derive the bit depth from qty (bytes per load).
+xcycle_t bench_rdp(benchmark_t *b) {
+    rdp_test_t test = b->args[0];
+    rdp_mode_t mode = b->args[1];
+    int w = b->args[2], h = b->args[3];
+    sprite_t *tex = NULL;
+
+    if (test == RDP_TEST_TEXRECT)
+        tex = sprite_new(32, 32, 2);
+    else if (test == RDP_TEST_LOAD)
+        tex = sprite_new(w, h, b->qty / (w*h));
+
+    rdp_begin();
+    xcycle_t t = SAMPLE_MULTI(20, XCYCLE_FROM_RCP(rdp_bench_run(test, mode, w, h, tex)));
+    rdp_end();
+
+    free(tex);
+    return timeit_per_iter(t, RDP_BENCH_PRIMS);
+}
+
+static benchmark_t *rdp_bench_new(const char *what, rdp_test_t test, rdp_mode_t mode,
+    int w, int h, int qty, unit_t unit)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "RDP %s %s", what, rdp_mode_names[mode]);
+
+    benchmark_t *b = bench_new(bench_rdp, CAT_RDP, name, qty, unit, CYCLE_RCP, 0);
+    b->args[0] = test;
+    b->args[1] = mode;
+    b->args[2] = w;
+    b->args[3] = h;
+    return b;
+}
+
+// Register fill rate (small and full-screen rectangles in each cycle mode),
+// triangle setup (a tiny triangle, and a larger one for comparison),
+// textured rectangles in copy mode and TMEM loads. Results are per
+// primitive; points are not graded.
+__attribute__((constructor))
+static void bench_rdp_register(void) {
+    static const struct { int w, h; } rect_sizes[] = {
+        { 16, 16 }, { RDP_FB_WIDTH, RDP_FB_HEIGHT },
+    };
+    // rdp.c can only load RGBA16 and RGBA32 textures. Sizes fill at most
+    // the 4 KiB of TMEM.
+    static const struct { int w, h, bitdepth; } load_sizes[] = {
+        { 8, 8, 2 }, { 16, 16, 2 }, { 32, 32, 2 }, { 64, 32, 2 },
+        { 8, 8, 4 }, { 16, 16, 4 }, { 32, 32, 4 },
+    };
+
+    for (int i=0; i < sizeof(rect_sizes)/sizeof(rect_sizes[0]); i++) {
+        int w = rect_sizes[i].w, h = rect_sizes[i].h;
+        for (rdp_mode_t mode=RDP_FILL; mode <= RDP_2CYCLE; mode++)
+            rdp_bench_new("rect", RDP_TEST_RECT, mode, w, h, w*h, UNIT_PIXELS);
+    }
+
+    rdp_bench_new("tri", RDP_TEST_TRI, RDP_1CYCLE, 2, 2, 2, UNIT_PIXELS);
+    rdp_bench_new("tri", RDP_TEST_TRI, RDP_1CYCLE, 64, 64, 64*64/2, UNIT_PIXELS);
+
+    rdp_bench_new("texrect", RDP_TEST_TEXRECT, RDP_COPY, 32, 32, 32*32, UNIT_PIXELS);
+    rdp_bench_new("texrect", RDP_TEST_TEXRECT, RDP_COPY, RDP_FB_WIDTH, RDP_FB_HEIGHT,
+        RDP_FB_WIDTH*RDP_FB_HEIGHT, UNIT_PIXELS);
+
+    for (int i=0; i < sizeof(load_sizes)/sizeof(load_sizes[0]); i++) {
+        int w = load_sizes[i].w, h = load_sizes[i].h, bpp = load_sizes[i].bitdepth;
+        rdp_bench_new(bpp == 2 ? "load RGBA16" : "load RGBA32", RDP_TEST_LOAD, RDP_COPY,
+            w, h, w*h*bpp, UNIT_BYTES);
+    }
+}
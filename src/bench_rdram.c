@@ -0,0 +1,76 @@
+#include "systembench.h"
+
+xcycle_t bench_ram_cached_r8(benchmark_t *b) {
+    volatile uint8_t *RAM = (volatile uint8_t*)(rambuf);
+    return TIMEIT_MULTI(50, ({ (void)*RAM; }), ({ (void)*RAM; }));
+}
+BENCHMARK(bench_ram_cached_r8, CAT_RDRAM, "RDRAM C8R", 1, UNIT_BYTES, CYCLE_CPU, XCYCLE_FROM_CPU(3));
+
+xcycle_t bench_ram_cached_r16(benchmark_t *b) {
+    volatile uint16_t *RAM = (volatile uint16_t*)(rambuf);
+    return TIMEIT_MULTI(50, ({ (void)*RAM; }), ({ (void)*RAM; }));
+}
+BENCHMARK(bench_ram_cached_r16, CAT_RDRAM, "RDRAM C16R", 2, UNIT_BYTES, CYCLE_CPU, XCYCLE_FROM_CPU(3));
+
+xcycle_t bench_ram_cached_r32(benchmark_t *b) {
+    volatile uint32_t *RAM = (volatile uint32_t*)(rambuf);
+    return TIMEIT_MULTI(50, ({ (void)*RAM; }), ({ (void)*RAM; }));
+}
+BENCHMARK(bench_ram_cached_r32, CAT_RDRAM, "RDRAM C32R", 4, UNIT_BYTES, CYCLE_CPU, XCYCLE_FROM_CPU(3));
+
+xcycle_t bench_ram_cached_r64(benchmark_t *b) {
+    volatile uint64_t *RAM = (volatile uint64_t*)(rambuf);
+    return TIMEIT_MULTI(50, ({ (void)*RAM; }), ({ (void)*RAM; }));
+}
+BENCHMARK(bench_ram_cached_r64, CAT_RDRAM, "RDRAM C64R", 8, UNIT_BYTES, CYCLE_CPU, XCYCLE_FROM_CPU(3));
+
+xcycle_t bench_ram_uncached_r8(benchmark_t *b) {
+    volatile uint8_t *RAM = (volatile uint8_t*)UncachedAddr(rambuf);
+    return TIMEIT_MULTI(50, ({ }), ({ (void)*RAM; }));
+}
+BENCHMARK(bench_ram_uncached_r8, CAT_RDRAM, "RDRAM U8R", 1, UNIT_BYTES, CYCLE_CPU, XCYCLE_FROM_CPU(34));
+
+xcycle_t bench_ram_uncached_r16(benchmark_t *b) {
+    volatile uint16_t *RAM = (volatile uint16_t*)UncachedAddr(rambuf);
+    return TIMEIT_MULTI(50, ({ }), ({ (void)*RAM; }));
+}
+BENCHMARK(bench_ram_uncached_r16, CAT_RDRAM, "RDRAM U16R", 2, UNIT_BYTES, CYCLE_CPU, XCYCLE_FROM_CPU(34));
+
+xcycle_t bench_ram_uncached_r32(benchmark_t *b) {
+    volatile uint32_t *RAM = (volatile uint32_t*)UncachedAddr(rambuf);
+    return TIMEIT_MULTI(50, ({ }), ({ (void)*RAM; }));
+}
+BENCHMARK(bench_ram_uncached_r32, CAT_RDRAM, "RDRAM U32R", 4, UNIT_BYTES, CYCLE_CPU, XCYCLE_FROM_CPU(34));
+
+xcycle_t bench_ram_uncached_r64(benchmark_t *b) {
+    volatile uint64_t *RAM = (volatile uint64_t*)UncachedAddr(rambuf);
+    return TIMEIT_MULTI(50, ({ }), ({ (void)*RAM; }));
+}
+BENCHMARK(bench_ram_uncached_r64, CAT_RDRAM, "RDRAM U64R", 8, UNIT_BYTES, CYCLE_CPU, XCYCLE_FROM_CPU(37));
+
+xcycle_t bench_ram_uncached_r32_seq(benchmark_t *b) {
+    volatile uint32_t *RAM0 = (volatile uint32_t*)UncachedAddr(rambuf);
+    volatile uint32_t *RAM1 = (volatile uint32_t*)UncachedAddr(rambuf+4);
+    volatile uint32_t *RAM2 = (volatile uint32_t*)UncachedAddr(rambuf+8);
+    volatile uint32_t *RAM3 = (volatile uint32_t*)UncachedAddr(rambuf+12);
+    return TIMEIT_MULTI(50, ({ }), ({ (void)*RAM0; (void)*RAM1; (void)*RAM2; (void)*RAM3; }));
+}
+BENCHMARK(bench_ram_uncached_r32_seq, CAT_RDRAM, "RDRAM U32R seq", 4*4, UNIT_BYTES, CYCLE_CPU, XCYCLE_FROM_CPU(134));
+
+xcycle_t bench_ram_uncached_r32_random(benchmark_t *b) {
+    volatile uint32_t *RAM0 = (volatile uint32_t*)UncachedAddr(rambuf+1024);
+    volatile uint32_t *RAM1 = (volatile uint32_t*)UncachedAddr(rambuf+12);
+    volatile uint32_t *RAM2 = (volatile uint32_t*)UncachedAddr(rambuf+568);
+    volatile uint32_t *RAM3 = (volatile uint32_t*)UncachedAddr(rambuf+912);
+    return TIMEIT_MULTI(50, ({ }), ({ (void)*RAM0; (void)*RAM1; (void)*RAM2; (void)*RAM3; }));
+}
+BENCHMARK(bench_ram_uncached_r32_random, CAT_RDRAM, "RDRAM U32R rand", 4*4, UNIT_BYTES, CYCLE_CPU, XCYCLE_FROM_CPU(134));
+
+xcycle_t bench_ram_uncached_r32_multibank(benchmark_t *b) {
+    volatile uint32_t *RAM0 = (volatile uint32_t*)UncachedAddr(0x80000000);
+    volatile uint32_t *RAM1 = (volatile uint32_t*)UncachedAddr(0x80100000);
+    volatile uint32_t *RAM2 = (volatile uint32_t*)UncachedAddr(0x80200000);
+    volatile uint32_t *RAM3 = (volatile uint32_t*)UncachedAddr(0x80300000);
+    return TIMEIT_MULTI(50, ({ }), ({ (void)*RAM0; (void)*RAM1; (void)*RAM2; (void)*RAM3; }));
+}
+BENCHMARK(bench_ram_uncached_r32_multibank, CAT_RDRAM, "RDRAM U32R banked", 4*4, UNIT_BYTES, CYCLE_CPU, XCYCLE_FROM_CPU(136));
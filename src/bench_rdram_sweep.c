@@ -0,0 +1,67 @@
+#include "systembench.h"
+
+// Number of accesses timed for each point of the sweep. Addresses wrap
+// around the whole RDRAM (4 or 8 MiB), so large strides hit many banks.
+#define RDRAM_SWEEP_ACCESSES     64
+
+// Read RDRAM_SWEEP_ACCESSES times with the given stride. The loop itself
+// costs a few cycles per access, which is visible in the small-stride cached
+// points (mostly cache hits).
+#define STRIDE_READ(type, base, stride, mask) ({ \
+    uint32_t __off = 0; \
+    for (int __i=0; __i < RDRAM_SWEEP_ACCESSES; __i++) { \
+        (void)*(volatile type *)((base) + __off); \
+        __off = (__off + (stride)) & (mask); \
+    } \
+})
+
+// Evict all the lines that the sweep is going to touch, so that every
+// cached access starts from a cold cache.
+static void stride_evict(uint32_t base, uint32_t stride, uint32_t mask) {
+    uint32_t off = 0;
+    for (int i=0; i < RDRAM_SWEEP_ACCESSES; i++) {
+        data_cache_hit_writeback_invalidate((void *)(base + off), 1);
+        off = (off + stride) & mask;
+    }
+}
+
+xcycle_t bench_ram_stride(benchmark_t *b) {
+    int width = b->args[0];
+    bool cached = b->args[1];
+    uint32_t stride = b->qty;
+    uint32_t mask = get_memory_size() - 1;
+    uint32_t base = cached ? 0x80000000 : 0xA0000000;
+
+    xcycle_t t;
+    switch (width) {
+    case 1: t = TIMEIT_MULTI(20, ({ if (cached) stride_evict(base, stride, mask); }),
+                ({ STRIDE_READ(uint8_t, base, stride, mask); })); break;
+    case 2: t = TIMEIT_MULTI(20, ({ if (cached) stride_evict(base, stride, mask); }),
+                ({ STRIDE_READ(uint16_t, base, stride, mask); })); break;
+    case 4: t = TIMEIT_MULTI(20, ({ if (cached) stride_evict(base, stride, mask); }),
+                ({ STRIDE_READ(uint32_t, base, stride, mask); })); break;
+    default: t = TIMEIT_MULTI(20, ({ if (cached) stride_evict(base, stride, mask); }),
+                ({ STRIDE_READ(uint64_t, base, stride, mask); })); break;
+    }
+    return timeit_per_iter(t, RDRAM_SWEEP_ACCESSES);
+}
+
+// Register one point per access mode, access width and stride (4 bytes to
+// 1 MiB, but never below the access width to keep accesses aligned). Each
+// point reports the cost of a single access.
+__attribute__((constructor))
+static void bench_ram_stride_register(void) {
+    char name[32];
+
+    for (int cached=1; cached >= 0; cached--) {
+        for (int width=1; width <= 8; width *= 2) {
+            snprintf(name, sizeof(name), "RDRAM %c%dR stride", cached ? 'C' : 'U', width*8);
+            for (int stride=(width > 4 ? width : 4); stride <= 1024*1024; stride *= 2) {
+                benchmark_t *b = bench_new(bench_ram_stride, CAT_RDRAM_SWEEP, name,
+                    stride, UNIT_STRIDE, CYCLE_CPU, 0);
+                b->args[0] = width;
+                b->args[1] = cached;
+            }
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#include "systembench.h"
+
+DEFINE_RSP_UCODE(rsp_bench);
+
+// Parameters of a test run, as laid out at the start of the rsp_bench DMEM
+typedef struct {
+    uint32_t test_id;
+    uint32_t iters;
+    uint32_t dma_size;
+    uint32_t rdram_addr;
+} rsp_bench_params_t;
+
+#define RSP_BENCH_RESULT_OFFSET  sizeof(rsp_bench_params_t)
+
+// Number of runs of the ucode per benchmark
+#define RSP_BENCH_SAMPLES        20
+
+// Tests implemented by rsp_bench.S, in the order of its TEST_TABLE
+enum {
+    RSP_TEST_DMA_READ,
+    RSP_TEST_DMA_WRITE,
+    RSP_TEST_DMA_READ_IMEM,
+    RSP_TEST_LQV,
+    RSP_TEST_SQV,
+    RSP_TEST_VU_DEP,
+    RSP_TEST_VU_INDEP,
+    RSP_TEST_BRANCH_TAKEN,
+    RSP_TEST_BRANCH_NOT_TAKEN,
+    RSP_TEST_MFC0_SP,
+    RSP_TEST_MFC0_DP,
+    RSP_TEST_MTC0_SEMA,
+};
+
+// Run a test on the RSP, and return the DP_CLOCK ticks spent in the test
+// minus those spent in an empty loop with the same number of iterations.
+static uint32_t rsp_bench_run(int test, int iters, int dma_size) {
+    static rsp_bench_params_t params __attribute__((aligned(8)));
+    static uint32_t result[2] __attribute__((aligned(8)));
+
+    params.test_id = test;
+    params.iters = iters;
+    params.dma_size = dma_size;
+    params.rdram_addr = PhysicalAddr(rambuf);
+    data_cache_hit_writeback(&params, sizeof(params));
+
+    rsp_load(&rsp_bench);
+    rsp_load_data(&params, sizeof(params), 0);
+    rsp_run();
+    rsp_read_data(result, sizeof(result), RSP_BENCH_RESULT_OFFSET);
+
+    // DP_CLOCK is a 24-bit counter
+    uint32_t empty = result[0] & 0xFFFFFF;
+    uint32_t full = result[1] & 0xFFFFFF;
+    return full > empty ? full - empty : 0;
+}
+
+// Time args[0] (test) for args[1] iterations of args[2] operations each.
+// DMA tests move qty bytes per iteration. The result is the cost of a single
+// operation (or transfer), in RCP cycles.
+xcycle_t bench_rsp(benchmark_t *b) {
+    int test = b->args[0], iters = b->args[1], ops = b->args[2];
+    xcycle_t t = SAMPLE_MULTI(RSP_BENCH_SAMPLES,
+        XCYCLE_FROM_RCP(rsp_bench_run(test, iters, b->qty)));
+    return timeit_per_iter(t, iters * ops);
+}
+
+static const struct {
+    const char *name;
+    int test;
+    unit_t unit;
+} rsp_benchs[] = {
+    { "RSP DMA R DMEM",  RSP_TEST_DMA_READ,         UNIT_BYTES },
+    { "RSP DMA W DMEM",  RSP_TEST_DMA_WRITE,        UNIT_BYTES },
+    { "RSP DMA R IMEM",  RSP_TEST_DMA_READ_IMEM,    UNIT_BYTES },
+    { "RSP LQV",         RSP_TEST_LQV,              UNIT_OPS },
+    { "RSP SQV",         RSP_TEST_SQV,              UNIT_OPS },
+    { "RSP VMUDH dep",   RSP_TEST_VU_DEP,           UNIT_OPS },
+    { "RSP VMUDH indep", RSP_TEST_VU_INDEP,         UNIT_OPS },
+    { "RSP B taken",     RSP_TEST_BRANCH_TAKEN,     UNIT_OPS },
+    { "RSP B not taken", RSP_TEST_BRANCH_NOT_TAKEN, UNIT_OPS },
+    { "RSP MFC0 SP",     RSP_TEST_MFC0_SP,          UNIT_OPS },
+    { "RSP MFC0 DP",     RSP_TEST_MFC0_DP,          UNIT_OPS },
+    { "RSP MTC0 SEMA",   RSP_TEST_MTC0_SEMA,        UNIT_OPS },
+};
+
+// DMA transfer sizes. IMEM transfers are limited to the upper half of IMEM.
+static const int rsp_dma_sizes[] = { 8, 128, 1024, 2048 };
+
+// Register all RSP tests. Expected values come from the platform profile
+// (see filesystem/expected/n64.txt).
+__attribute__((constructor))
+static void bench_rsp_register(void) {
+    for (int i=0; i < sizeof(rsp_benchs)/sizeof(rsp_benchs[0]); i++) {
+        if (rsp_benchs[i].unit == UNIT_BYTES) {
+            for (int j=0; j < sizeof(rsp_dma_sizes)/sizeof(rsp_dma_sizes[0]); j++) {
+                benchmark_t *b = bench_new(bench_rsp, CAT_RSP, rsp_benchs[i].name,
+                    rsp_dma_sizes[j], UNIT_BYTES, CYCLE_RCP, 0);
+                b->args[0] = rsp_benchs[i].test;
+                b->args[1] = 16;
+                b->args[2] = 1;
+            }
+        } else {
+            benchmark_t *b = bench_new(bench_rsp, CAT_RSP, rsp_benchs[i].name,
+                1, UNIT_OPS, CYCLE_RCP, 0);
+            b->args[0] = rsp_benchs[i].test;
+            b->args[1] = 256;
+            b->args[2] = 8;
+        }
+    }
+}
@@ -0,0 +1,209 @@
+#include "systembench.h"
+#include <rspq.h>
+
+DEFINE_RSP_UCODE(rsp_bench_ovl);
+DEFINE_RSP_UCODE(rsp_bench_ovl_b);
+DEFINE_RSP_UCODE(rsp_bench_ovl1k);
+DEFINE_RSP_UCODE(rsp_bench_ovl1k_b);
+DEFINE_RSP_UCODE(rsp_bench_ovl2k);
+DEFINE_RSP_UCODE(rsp_bench_ovl2k_b);
+
+// Commands written in each sample. They must fit in a lowpri buffer, so that
+// samples do not include waits for the RSP.
+#define RSPQ_BENCH_CMDS          16
+
+typedef enum {
+    RSPQ_WRITE,             // CPU cost of rspq_write
+    RSPQ_RUN,               // rspq_write until the RSP has run the commands
+    RSPQ_BLOCK,             // Same commands, recorded in a block
+    RSPQ_FLUSH,             // From rspq_flush to the RSP running a command
+    RSPQ_HIGHPRI,           // CPU cost of rspq_highpri_begin + end
+    RSPQ_HIGHPRI_SYNC,      // Round trip of a highpri sequence
+    RSPQ_SWITCH,            // Overlay switch between two overlays of the same size
+    RSPQ_SWITCH_RESIDENT,   // Overlay switch between the 2 KiB overlay and the small one
+    RSPQ_SYNCPOINT,         // rspq_syncpoint_wait on a pending syncpoint
+} rspq_test_t;
+
+// The first overlay is the one commands are normally sent to. The others
+// are used for overlay switches, in pairs of the same code size: with 1 KiB
+// and 2 KiB of padding after the code. The RSP only reloads the start of the
+// code of the biggest overlay loaded (the resident one) when it was
+// overwritten by a smaller overlay, so switches within a pair are full loads.
+#define RSPQ_BENCH_OVLS          6
+
+static rsp_ucode_t *rspq_ovls[RSPQ_BENCH_OVLS] = {
+    &rsp_bench_ovl, &rsp_bench_ovl_b, &rsp_bench_ovl1k, &rsp_bench_ovl1k_b,
+    &rsp_bench_ovl2k, &rsp_bench_ovl2k_b,
+};
+static uint32_t rspq_ovl_ids[RSPQ_BENCH_OVLS];
+
+static void rspq_bench_cmd(uint32_t ovl, int words) {
+    switch (words) {
+    case 1:  rspq_write(ovl, 0x0); break;
+    case 4:  rspq_write(ovl, 0x1, 0, 0, 0, 0); break;
+    default: rspq_write(ovl, 0x2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0); break;
+    }
+}
+
+// Syncpoints are signaled by the SP interrupt, so the benchmarks run with
+// interrupts enabled.
+static void rspq_bench_begin(void) {
+    // The polling benchmarks leave the SI interrupt pending, which would be
+    // taken by joybus as the completion of a transfer.
+    SI_regs->status = SI_WSTATUS_INTACK;
+
+    rspq_init();
+    for (int i=0; i<RSPQ_BENCH_OVLS; i++)
+        rspq_ovl_ids[i] = rspq_overlay_register(rspq_ovls[i]);
+    enable_interrupts();
+}
+
+static void rspq_bench_end(void) {
+    rspq_wait();
+    disable_interrupts();
+    for (int i=RSPQ_BENCH_OVLS-1; i>=0; i--)
+        rspq_overlay_unregister(rspq_ovl_ids[i]);
+    rspq_close();
+}
+
+// Run n commands alternating between two overlays (or always on the first
+// one if alt is 0), and wait for them.
+static xcycle_t rspq_switch_sample(int ovl_a, int ovl_b, bool alt, int n) {
+    uint32_t a = rspq_ovl_ids[ovl_a], b = rspq_ovl_ids[ovl_b];
+    return TIMEIT(({ rspq_bench_cmd(a, 1); rspq_wait(); }), ({
+        for (int i=0; i<n; i++)
+            rspq_bench_cmd(alt && (i & 1) ? b : a, 1);
+        rspq_wait();
+    }));
+}
+
+// args[0] is the test, args[1] the size of the commands in words, or the
+// index of the first overlay of the pair for RSPQ_SWITCH.
+xcycle_t bench_rspq(benchmark_t *b) {
+    rspq_test_t test = b->args[0];
+    int words = b->args[1];
+    xcycle_t t = 0;
+
+    rspq_bench_begin();
+    uint32_t ovl = rspq_ovl_ids[0];
+
+    switch (test) {
+    case RSPQ_WRITE:
+        t = TIMEIT_MULTI(20, ({ rspq_wait(); }), ({
+            for (int i=0; i<RSPQ_BENCH_CMDS; i++)
+                rspq_bench_cmd(ovl, words);
+        }));
+        t = timeit_per_iter(t, RSPQ_BENCH_CMDS);
+        break;
+    case RSPQ_RUN:
+        t = TIMEIT_MULTI(20, ({ rspq_wait(); }), ({
+            for (int i=0; i<RSPQ_BENCH_CMDS; i++)
+                rspq_bench_cmd(ovl, words);
+            rspq_wait();
+        }));
+        t = timeit_per_iter(t, RSPQ_BENCH_CMDS);
+        break;
+    case RSPQ_BLOCK: {
+        rspq_block_begin();
+        for (int i=0; i<RSPQ_BENCH_CMDS; i++)
+            rspq_bench_cmd(ovl, words);
+        rspq_block_t *block = rspq_block_end();
+        t = TIMEIT_MULTI(20, ({ rspq_wait(); }), ({
+            rspq_block_run(block);
+            rspq_wait();
+        }));
+        t = timeit_per_iter(t, RSPQ_BENCH_CMDS);
+        rspq_wait();
+        rspq_block_free(block);
+        break;
+    }
+    case RSPQ_FLUSH:
+        // SIG0 is set by the RSP when it runs the command
+        t = TIMEIT_WHILE_MULTI(20, ({
+            rspq_wait();
+            *SP_STATUS = SP_WSTATUS_CLEAR_SIG0;
+            rspq_signal(SP_WSTATUS_SET_SIG0);
+        }), ({
+            rspq_flush();
+        }), !(*SP_STATUS & SP_STATUS_SIG0));
+        break;
+    case RSPQ_HIGHPRI:
+        t = TIMEIT_MULTI(20, ({ rspq_highpri_sync(); }), ({
+            rspq_highpri_begin();
+            rspq_bench_cmd(ovl, 1);
+            rspq_highpri_end();
+        }));
+        rspq_highpri_sync();
+        break;
+    case RSPQ_HIGHPRI_SYNC:
+        t = TIMEIT_MULTI(20, ({ rspq_wait(); }), ({
+            rspq_highpri_begin();
+            rspq_bench_cmd(ovl, 1);
+            rspq_highpri_end();
+            rspq_highpri_sync();
+        }));
+        break;
+    case RSPQ_SWITCH:
+    case RSPQ_SWITCH_RESIDENT: {
+        // Difference between alternating overlays and staying on the same
+        // one, per round trip to the other overlay and back. The resident
+        // switch alternates the 2 KiB overlay, which stays resident, with the
+        // small one, which only overwrites the start of its code.
+        int a = test == RSPQ_SWITCH ? words : 4;
+        int b = test == RSPQ_SWITCH ? words + 1 : 0;
+        t = SAMPLE_MULTI(20, ({
+            xcycle_t t_alt = rspq_switch_sample(a, b, true, RSPQ_BENCH_CMDS);
+            xcycle_t t_same = rspq_switch_sample(a, b, false, RSPQ_BENCH_CMDS);
+            t_alt > t_same ? t_alt - t_same : 0;
+        }));
+        t = timeit_per_iter(t, RSPQ_BENCH_CMDS/2);
+        break;
+    }
+    case RSPQ_SYNCPOINT: {
+        rspq_syncpoint_t sp;
+        t = TIMEIT_MULTI(20, ({ rspq_wait(); sp = rspq_syncpoint_new(); }), ({
+            rspq_syncpoint_wait(sp);
+        }));
+        break;
+    }
+    }
+
+    rspq_bench_end();
+    return t;
+}
+
+static void rspq_bench_new(const char *name, rspq_test_t test, int arg, int qty, unit_t unit) {
+    benchmark_t *b = bench_new(bench_rspq, CAT_RSPQ, name, qty, unit, CYCLE_CPU, 0);
+    b->args[0] = test;
+    b->args[1] = arg;
+}
+
+// Register command cost by size (CPU side, end to end, and from a block),
+// flush wakeup, highpri and syncpoint latencies, and overlay switches by
+// code size. Results are per command; points are not graded.
+__attribute__((constructor))
+static void bench_rspq_register(void) {
+    static const int sizes[] = { 1, 4, 16 };
+    char name[32];
+
+    for (int i=0; i<3; i++) {
+        int words = sizes[i];
+        snprintf(name, sizeof(name), "RSPQ write %dw", words);
+        rspq_bench_new(name, RSPQ_WRITE, words, 1, UNIT_OPS);
+        snprintf(name, sizeof(name), "RSPQ run %dw", words);
+        rspq_bench_new(name, RSPQ_RUN, words, 1, UNIT_OPS);
+        snprintf(name, sizeof(name), "RSPQ block %dw", words);
+        rspq_bench_new(name, RSPQ_BLOCK, words, 1, UNIT_OPS);
+    }
+
+    rspq_bench_new("RSPQ flush wakeup", RSPQ_FLUSH, 0, 1, UNIT_OPS);
+    rspq_bench_new("RSPQ highpri begin+end", RSPQ_HIGHPRI, 0, 1, UNIT_OPS);
+    rspq_bench_new("RSPQ highpri sync", RSPQ_HIGHPRI_SYNC, 0, 1, UNIT_OPS);
+    rspq_bench_new("RSPQ syncpoint wait", RSPQ_SYNCPOINT, 0, 1, UNIT_OPS);
+
+    // qty is the size of the code of the overlays
+    rspq_bench_new("RSPQ ovl switch", RSPQ_SWITCH, 0, 8, UNIT_BYTES);
+    rspq_bench_new("RSPQ ovl switch", RSPQ_SWITCH, 2, 8+1024, UNIT_BYTES);
+    rspq_bench_new("RSPQ ovl switch", RSPQ_SWITCH, 4, 8+2048, UNIT_BYTES);
+    rspq_bench_new("RSPQ ovl switch resident", RSPQ_SWITCH_RESIDENT, 0, 8+2048, UNIT_BYTES);
+}
@@ -1,109 +1,22 @@
 #include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
 #include <stdalign.h>
-#include <libdragon.h>
-#include "../libdragon/include/regsinternal.h"
-
-typedef uint64_t xcycle_t;
-
-#define RCP_FREQUENCY            62500000              // N64 & iQue
-#define RCP_FACTOR               9                     // Scaling factor to convert to xcycle
-#define CPU_FACTOR               (RCP_FREQUENCY * RCP_FACTOR / CPU_FREQUENCY)   // CPU Scaling factor (different N64 vs iQue)
-#define COP0_FACTOR              (CPU_FACTOR * 2)
-
-#define XCYCLES_PER_SECOND       XCYCLE_FROM_CPU(CPU_FREQUENCY)
-#define XCYCLE_FROM_COP0(t)      ((t) * COP0_FACTOR)
-#define XCYCLE_FROM_CPU(t)       ((t) * CPU_FACTOR)
-#define XCYCLE_FROM_RCP(t)       ((t) * RCP_FACTOR)
-
-#define MEASUREMENT_ERROR_CPU    XCYCLE_FROM_CPU(1)    // Sampling error when measuring CPU cycles
-#define MEASUREMENT_ERROR_RCP    XCYCLE_FROM_CPU(4)    // Sampling error when measuring RCP cycles
-
-
-typedef enum {
-    CYCLE_RCP,
-    CYCLE_CPU,
-    CYCLE_COP0,
-} cycletype_t;
-
-typedef enum {
-    UNIT_BYTES
-} unit_t;
-
-struct benchmark_s;
-typedef struct benchmark_s benchmark_t;
-
-typedef struct benchmark_s {
-    xcycle_t (*func)(benchmark_t* b);
-    const char *name;
-    int qty;
-    unit_t unit;
-    cycletype_t cycletype;
-
-    xcycle_t expected;
-    float tolerance;
-    xcycle_t found;
-    bool passed_0p, passed_5p, passed_10p, passed_30p;
-} benchmark_t;
-
-DEFINE_RSP_UCODE(rsp_bench);
+#include <unistd.h>
+#include "systembench.h"
 
 uint8_t rambuf[1024*1024] alignas(64);
 
-static volatile struct VI_regs_s * const VI_regs = (struct VI_regs_s *)0xa4400000;
-static volatile struct PI_regs_s * const PI_regs = (struct PI_regs_s *)0xa4600000;
-static volatile struct SI_regs_s * const SI_regs = (struct SI_regs_s *)0xa4800000;
-
-static volatile void *PIF_ROM = (void *)0x1fc00700;
-static volatile void *PIF_RAM = (void *)0x1fc007c0;
-
-#define PIF
-
-#define PI_STATUS_DMA_BUSY ( 1 << 0 )
-#define PI_STATUS_IO_BUSY  ( 1 << 1 )
-
-#define SI_STATUS_DMA_BUSY ( 1 << 0 )
-#define SI_STATUS_IO_BUSY  ( 1 << 1 )
-#define SI_WSTATUS_INTACK  0
-
-#define TIMEIT(setup, stmt) ({ \
-    MEMORY_BARRIER(); \
-    setup; \
-    uint32_t __t0 = TICKS_READ(); \
-    stmt; \
-    uint32_t __t1 = TICKS_READ(); \
-    MEMORY_BARRIER(); \
-    XCYCLE_FROM_COP0(TICKS_DISTANCE(__t0, __t1)); \
-})
-
-#define TIMEIT_WHILE(setup, stmt, cond) ({ \
-    register uint32_t __t1,__t2,__t3,__t4,__t5,__t6, __t7, __t8; \
-    register bool __c1, __c2, __c3, __c4, __c5, __c6, __c7, __c8; \
-    MEMORY_BARRIER(); \
-    setup; \
-    uint32_t __t0 = TICKS_READ(); \
-    stmt; \
-    do { \
-        __t1 = TICKS_READ(); __c1 = (cond); \
-        __t2 = TICKS_READ(); __c2 = (cond); \
-        __t3 = TICKS_READ(); __c3 = (cond); \
-        __t4 = TICKS_READ(); __c4 = (cond); \
-        __t5 = TICKS_READ(); __c5 = (cond); \
-        __t6 = TICKS_READ(); __c6 = (cond); \
-        __t7 = TICKS_READ(); __c7 = (cond); \
-        __t8 = TICKS_READ(); __c8 = (cond); \
-    } while (__c8); \
-    uint32_t __tend; \
-    if (!__c1) __tend = __t1; \
-    else if (!__c2) __tend = __t2; \
-    else if (!__c3) __tend = __t3; \
-    else if (!__c4) __tend = __t4; \
-    else if (!__c5) __tend = __t5; \
-    else if (!__c6) __tend = __t6; \
-    else if (!__c7) __tend = __t7; \
-    else __tend = __t8; \
-    MEMORY_BARRIER(); \
-    XCYCLE_FROM_COP0(TICKS_DISTANCE(__t0, __tend)); \
-})
+xcycle_t timeit_overhead, timeit_while_overhead;
+static xcycle_t timeit_residual;        // Floor of the measurement error (0 unless overhead is subtracted)
+
+// Raw samples of the last TIMEIT_MULTI run, kept around for the result stream.
+static xcycle_t last_samples[MAX_SAMPLES];
+static int last_num_samples;
+static stats_t last_stats;
+// Statistic returned by timeit_stats() (see JUDGE_STAT and "judge" in the config)
+static stat_t judge_stat = JUDGE_STAT;
 
 __attribute__((noinline))
 xcycle_t timeit_average(xcycle_t *samples, int n) {
@@ -119,403 +32,262 @@ xcycle_t timeit_average(xcycle_t *samples, int n) {
     return total / (n-2);
 }
 
-#define TIMEIT_MULTI(n, setup, stmt) ({ \
-    int __n = (n); \
-    xcycle_t __samples[__n]; \
-    for (int __i=0; __i < __n; __i++) \
-        __samples[__i] = TIMEIT(setup, stmt); \
-    timeit_average(__samples, __n); \
-})
-
-#define TIMEIT_WHILE_MULTI(n, setup, stmt, cond) ({ \
-    int __n = (n); \
-    xcycle_t __samples[__n]; \
-    for (int __i=0; __i < __n; __i++) \
-        __samples[__i] = TIMEIT_WHILE(setup, stmt, cond); \
-    timeit_average(__samples, __n); \
-})
-
-static inline void fill_out_buffer(void) {
-    uint32_t *__buf = UncachedAddr(rambuf);
-    __buf[0] = 0;
-    __buf[1] = 0;
-    __buf[2] = 0;
-    __buf[3] = 0;
-    __buf[4] = 0;
-    __buf[5] = 0;
-}
-
-xcycle_t bench_rcp_io_r(benchmark_t *b) {
-    return TIMEIT_MULTI(50, ({ }), ({ (void)VI_regs->control; }));
-}
-
-xcycle_t bench_rcp_io_w(benchmark_t *b) {
-    return TIMEIT_MULTI(50, fill_out_buffer(), ({ VI_regs->control = 0; }));
-}
-
-xcycle_t bench_pidma(benchmark_t* b) {
-    return TIMEIT_WHILE_MULTI(10, ({
-        PI_regs->ram_address = rambuf;
-        PI_regs->pi_address = 0x10000000;
-    }), ({
-        PI_regs->write_length = b->qty-1;        
-    }), ({
-        PI_regs->status & (PI_STATUS_DMA_BUSY | PI_STATUS_IO_BUSY);
-    }));
-}
-
-xcycle_t bench_piior(benchmark_t* b) {
-    volatile uint32_t *ROM = (volatile uint32_t*)0xB0000000;
-    return TIMEIT_MULTI(50, ({ }), ({ (void)*ROM; }));
-}
-
-xcycle_t bench_piiow(benchmark_t* b) {
-    volatile uint32_t *ROM = (volatile uint32_t*)0xB0000000;
-    return TIMEIT_WHILE_MULTI(50, ({ }), ({ 
-        ROM[0] = 0;
-    }), ({  
-        PI_regs->status & (PI_STATUS_DMA_BUSY | PI_STATUS_IO_BUSY);
-    }));
-}
-
-xcycle_t bench_sidmaw_ram(benchmark_t* b) {
-    return TIMEIT_WHILE_MULTI(10, ({
-        SI_regs->DRAM_addr = rambuf;
-    }), ({
-        SI_regs->PIF_addr_write = PIF_RAM;
-    }), ({
-        SI_regs->status & (SI_STATUS_DMA_BUSY | SI_STATUS_IO_BUSY);
-    }));
-}
-
-xcycle_t bench_sidmaw_rom(benchmark_t* b) {
-    return TIMEIT_WHILE_MULTI(10, ({
-        SI_regs->DRAM_addr = rambuf;
-    }), ({
-        SI_regs->PIF_addr_write = PIF_ROM;
-    }), ({
-        SI_regs->status & (SI_STATUS_DMA_BUSY | SI_STATUS_IO_BUSY);
-    }));
-}
-
-xcycle_t bench_siior(benchmark_t* b) {
-    volatile uint32_t *PIF_RAM = (volatile uint32_t*)0xBFC007C0;
-    return TIMEIT_MULTI(50, ({ }), ({ (void)*PIF_RAM; }));
-}
-
-xcycle_t bench_siiow(benchmark_t* b) {
-    volatile uint32_t *PIF_RAM = (volatile uint32_t*)0xBFC007C0;
-    return TIMEIT_WHILE_MULTI(50, ({ }), ({ 
-        PIF_RAM[0] = 0;
-    }), ({  
-        SI_regs->status & (SI_STATUS_DMA_BUSY | SI_STATUS_IO_BUSY);
-    }));
-}
-
-xcycle_t bench_ram_cached_r8(benchmark_t *b) {
-    volatile uint8_t *RAM = (volatile uint8_t*)(rambuf);
-    return TIMEIT_MULTI(50, ({ (void)*RAM; }), ({ (void)*RAM; }));
-}
-
-xcycle_t bench_ram_cached_r16(benchmark_t *b) {
-    volatile uint16_t *RAM = (volatile uint16_t*)(rambuf);
-    return TIMEIT_MULTI(50, ({ (void)*RAM; }), ({ (void)*RAM; }));
-}
-
-xcycle_t bench_ram_cached_r32(benchmark_t *b) {
-    volatile uint32_t *RAM = (volatile uint32_t*)(rambuf);
-    return TIMEIT_MULTI(50, ({ (void)*RAM; }), ({ (void)*RAM; }));
-}
-
-xcycle_t bench_ram_cached_r64(benchmark_t *b) {
-    volatile uint64_t *RAM = (volatile uint64_t*)(rambuf);
-    return TIMEIT_MULTI(50, ({ (void)*RAM; }), ({ (void)*RAM; }));
-}
-
-xcycle_t bench_ram_uncached_r8(benchmark_t *b) {
-    volatile uint8_t *RAM = (volatile uint8_t*)UncachedAddr(rambuf);
-    return TIMEIT_MULTI(50, ({ }), ({ (void)*RAM; }));
-}
-
-xcycle_t bench_ram_uncached_r16(benchmark_t *b) {
-    volatile uint16_t *RAM = (volatile uint16_t*)UncachedAddr(rambuf);
-    return TIMEIT_MULTI(50, ({ }), ({ (void)*RAM; }));
-}
-
-xcycle_t bench_ram_uncached_r32(benchmark_t *b) {
-    volatile uint32_t *RAM = (volatile uint32_t*)UncachedAddr(rambuf);
-    return TIMEIT_MULTI(50, ({ }), ({ (void)*RAM; }));
-}
-
-xcycle_t bench_ram_uncached_r64(benchmark_t *b) {
-    volatile uint64_t *RAM = (volatile uint64_t*)UncachedAddr(rambuf);
-    return TIMEIT_MULTI(50, ({ }), ({ (void)*RAM; }));
-}
-
-xcycle_t bench_ram_uncached_r32_seq(benchmark_t *b) {
-    volatile uint32_t *RAM0 = (volatile uint32_t*)UncachedAddr(rambuf);
-    volatile uint32_t *RAM1 = (volatile uint32_t*)UncachedAddr(rambuf+4);
-    volatile uint32_t *RAM2 = (volatile uint32_t*)UncachedAddr(rambuf+8);
-    volatile uint32_t *RAM3 = (volatile uint32_t*)UncachedAddr(rambuf+12);
-    return TIMEIT_MULTI(50, ({ }), ({ (void)*RAM0; (void)*RAM1; (void)*RAM2; (void)*RAM3; }));
-}
-
-xcycle_t bench_ram_uncached_r32_random(benchmark_t *b) {
-    volatile uint32_t *RAM0 = (volatile uint32_t*)UncachedAddr(rambuf+1024);
-    volatile uint32_t *RAM1 = (volatile uint32_t*)UncachedAddr(rambuf+12);
-    volatile uint32_t *RAM2 = (volatile uint32_t*)UncachedAddr(rambuf+568);
-    volatile uint32_t *RAM3 = (volatile uint32_t*)UncachedAddr(rambuf+912);
-    return TIMEIT_MULTI(50, ({ }), ({ (void)*RAM0; (void)*RAM1; (void)*RAM2; (void)*RAM3; }));
+static xcycle_t percentile(xcycle_t *sorted, int n, int p) {
+    // Nearest-rank method
+    int rank = (p * n + 99) / 100;
+    if (rank < 1) rank = 1;
+    return sorted[rank-1];
 }
 
-xcycle_t bench_ram_uncached_r32_multibank(benchmark_t *b) {
-    volatile uint32_t *RAM0 = (volatile uint32_t*)UncachedAddr(0x80000000);
-    volatile uint32_t *RAM1 = (volatile uint32_t*)UncachedAddr(0x80100000);
-    volatile uint32_t *RAM2 = (volatile uint32_t*)UncachedAddr(0x80200000);
-    volatile uint32_t *RAM3 = (volatile uint32_t*)UncachedAddr(0x80300000);
-    return TIMEIT_MULTI(50, ({ }), ({ (void)*RAM0; (void)*RAM1; (void)*RAM2; (void)*RAM3; }));
-}
+void stats_compute(stats_t *st, xcycle_t *samples, int n) {
+    memset(st, 0, sizeof(*st));
+    if (n <= 0) return;
 
-static void joybus_write(uint64_t *in) {
-    SI_regs->status = SI_WSTATUS_INTACK;
-    SI_regs->DRAM_addr = in;
-    SI_regs->PIF_addr_write = PIF_RAM;
-    while (SI_regs->status & (SI_STATUS_DMA_BUSY | SI_STATUS_IO_BUSY)) {}
-    SI_regs->status = SI_WSTATUS_INTACK;
-}
-static void joybus_read(uint64_t *out) {
-    SI_regs->DRAM_addr = out;
-    SI_regs->PIF_addr_read = PIF_RAM;
-    while (SI_regs->status & (SI_STATUS_DMA_BUSY | SI_STATUS_IO_BUSY)) {}
-}
+    // Insertion sort: n is small and this runs outside of the timed sections
+    xcycle_t sorted[n];
+    for (int i=0;i<n;i++) {
+        int j = i;
+        while (j > 0 && sorted[j-1] > samples[i]) {
+            sorted[j] = sorted[j-1];
+            j--;
+        }
+        sorted[j] = samples[i];
+    }
 
-xcycle_t bench_joybus_empty0(benchmark_t *b) {
-    uint64_t *buf = UncachedAddr(rambuf);
-    uint64_t *out = UncachedAddr(rambuf+64);
-
-    return TIMEIT_MULTI(50, ({ 
-        buf[0] = 0xfe00000000000000;
-        buf[1] = 0;
-        buf[2] = 0;
-        buf[3] = 0;
-        buf[4] = 0;
-        buf[5] = 0;
-        buf[6] = 0;
-        buf[7] = 1;       
-        joybus_write(buf); 
-    }), ({ joybus_read(out); }));
-}
+    st->n = n;
+    st->min = sorted[0];
+    st->max = sorted[n-1];
+    st->mean = n > 2 ? timeit_average(samples, n) : sorted[0];
+    st->median = (n & 1) ? sorted[n/2] : (sorted[n/2-1] + sorted[n/2]) / 2;
+    st->p5 = percentile(sorted, n, 5);
+    st->p95 = percentile(sorted, n, 95);
+
+    double sum = 0, sum2 = 0;
+    for (int i=0;i<n;i++) {
+        sum += sorted[i];
+        sum2 += (double)sorted[i] * sorted[i];
+    }
+    double avg = sum / n;
+    double var = sum2 / n - avg * avg;
+    st->stddev = var > 0 ? sqrt(var) : 0;
+    st->ci95 = 1.96 * st->stddev / sqrt(n);
 
-xcycle_t bench_joybus_empty0b(benchmark_t *b) {
-    uint64_t *buf = UncachedAddr(rambuf);
-    uint64_t *out = UncachedAddr(rambuf+64);
-
-    return TIMEIT_MULTI(50, ({ 
-        buf[0] = 0x00fe000000000000;
-        buf[1] = 0;
-        buf[2] = 0;
-        buf[3] = 0;
-        buf[4] = 0;
-        buf[5] = 0;
-        buf[6] = 0;
-        buf[7] = 1;       
-        joybus_write(buf); 
-    }), ({ joybus_read(out); }));
+    st->hist_width = (st->max - st->min) / STATS_HIST_BUCKETS + 1;
+    for (int i=0;i<n;i++)
+        st->hist[(sorted[i] - st->min) / st->hist_width]++;
 }
 
-xcycle_t bench_joybus_empty0c(benchmark_t *b) {
-    uint64_t *buf = UncachedAddr(rambuf);
-    uint64_t *out = UncachedAddr(rambuf+64);
-
-    return TIMEIT_MULTI(50, ({ 
-        buf[0] = 0x00000000fe000000;
-        buf[1] = 0;
-        buf[2] = 0;
-        buf[3] = 0;
-        buf[4] = 0;
-        buf[5] = 0;
-        buf[6] = 0;
-        buf[7] = 1;       
-        joybus_write(buf); 
-    }), ({ joybus_read(out); }));
+xcycle_t stats_get(stats_t *st, stat_t which) {
+    switch (which) {
+    case STAT_MEDIAN: return st->median;
+    case STAT_P5:     return st->p5;
+    case STAT_P95:    return st->p95;
+    default:          return st->mean;
+    }
 }
 
-xcycle_t bench_joybus_empty1(benchmark_t *b) {
-    uint64_t *buf = UncachedAddr(rambuf);
-    uint64_t *out = UncachedAddr(rambuf+64);
-
-    return TIMEIT_MULTI(50, ({ 
-        buf[0] = 0;
-        buf[1] = 0xfe00000000000000;
-        buf[2] = 0;
-        buf[3] = 0;
-        buf[4] = 0;
-        buf[5] = 0;
-        buf[6] = 0;
-        buf[7] = 1;       
-        joybus_write(buf); 
-    }), ({ joybus_read(out); }));
+// Record the samples of a TIMEIT_MULTI run, and return the statistic
+// selected by judge_stat.
+__attribute__((noinline))
+xcycle_t timeit_stats(xcycle_t *samples, int n) {
+    last_num_samples = n < MAX_SAMPLES ? n : MAX_SAMPLES;
+    memcpy(last_samples, samples, last_num_samples * sizeof(xcycle_t));
+    stats_compute(&last_stats, samples, n);
+    return stats_get(&last_stats, judge_stat);
 }
 
-
-xcycle_t bench_joybus_empty4(benchmark_t *b) {
-    uint64_t *buf = UncachedAddr(rambuf);
-    uint64_t *out = UncachedAddr(rambuf+64);
-
-    return TIMEIT_MULTI(50, ({ 
-        buf[0] = 0;
-        buf[1] = 0;
-        buf[2] = 0;
-        buf[3] = 0;
-        buf[4] = 0xfe00000000000000;
-        buf[5] = 0;
-        buf[6] = 0;
-        buf[7] = 1;
-        joybus_write(buf); 
-    }), ({ joybus_read(out); }));
+xcycle_t timeit_per_iter(xcycle_t total, int iters) {
+    for (int i=0;i<last_num_samples;i++)
+        last_samples[i] /= iters;
+    stats_compute(&last_stats, last_samples, last_num_samples);
+    return total / iters;
 }
 
-xcycle_t bench_joybus_empty7(benchmark_t *b) {
-    uint64_t *buf = UncachedAddr(rambuf);
-    uint64_t *out = UncachedAddr(rambuf+64);
-
-    return TIMEIT_MULTI(50, ({ 
-        buf[0] = 0;
-        buf[1] = 0;
-        buf[2] = 0;
-        buf[3] = 0;
-        buf[4] = 0;
-        buf[5] = 0;
-        buf[6] = 0;
-        buf[7] = 0xfe00000000000001;       
-        joybus_write(buf); 
-    }), ({ joybus_read(out); }));
-}
+__attribute__((noinline))
+bool adaptive_done(adaptive_t *a, xcycle_t sample) {
+    if (!ADAPTIVE_SAMPLING) return false;
 
-xcycle_t bench_joybus_empty7e(benchmark_t *b) {
-    uint64_t *buf = UncachedAddr(rambuf);
-    uint64_t *out = UncachedAddr(rambuf+64);
-
-    return TIMEIT_MULTI(50, ({ 
-        buf[0] = 0;
-        buf[1] = 0;
-        buf[2] = 0;
-        buf[3] = 0;
-        buf[4] = 0;
-        buf[5] = 0;
-        buf[6] = 0;
-        buf[7] = 0x000000000000fe01;       
-        joybus_write(buf); 
-    }), ({ joybus_read(out); }));
-}
+    a->n++;
+    a->sum += sample;
+    a->sum2 += (double)sample * sample;
+    if (a->n < ADAPTIVE_MIN_SAMPLES) return false;
+    if (TICKS_DISTANCE(a->t0, TICKS_READ()) > TICKS_FROM_MS(ADAPTIVE_BUDGET_MS)) return true;
 
-xcycle_t bench_joybus_1j(benchmark_t *b) {
-    uint64_t *buf = UncachedAddr(rambuf);
-    uint64_t *out = UncachedAddr(rambuf+64);
-
-    return TIMEIT_MULTI(50, ({ 
-        buf[0] = 0xff010401ffffffff;
-        buf[1] = 0xfe00000000000000;
-        buf[2] = 0;
-        buf[3] = 0;
-        buf[4] = 0;
-        buf[5] = 0;
-        buf[6] = 0;
-        buf[7] = 1;       
-        joybus_write(buf); 
-    }), ({ joybus_read(out); }));
+    double avg = a->sum / a->n;
+    double var = a->sum2 / a->n - avg * avg;
+    double ci95 = var > 0 ? 1.96 * sqrt(var / a->n) : 0;
+    return ci95 <= MEASUREMENT_ERROR_CPU || ci95 * 100.0 <= avg * ADAPTIVE_TARGET_PCT;
 }
 
-xcycle_t bench_joybus_2j(benchmark_t *b) {
-    uint64_t *buf = UncachedAddr(rambuf);
-    uint64_t *out = UncachedAddr(rambuf+64);
-
-    return TIMEIT_MULTI(50, ({ 
-        buf[0] = 0xff010401ffffffff;
-        buf[1] = 0xff010401ffffffff;
-        buf[2] = 0xfe00000000000000;
-        buf[3] = 0;
-        buf[4] = 0;
-        buf[5] = 0;
-        buf[6] = 0;
-        buf[7] = 1;       
-        joybus_write(buf); 
-    }), ({ joybus_read(out); }));
-}
+/**************************************************************************************/
 
-xcycle_t bench_joybus_3j(benchmark_t *b) {
-    uint64_t *buf = UncachedAddr(rambuf);
-    uint64_t *out = UncachedAddr(rambuf+64);
-
-    return TIMEIT_MULTI(50, ({ 
-        buf[0] = 0xff010401ffffffff;
-        buf[1] = 0xff010401ffffffff;
-        buf[2] = 0xff010401ffffffff;
-        buf[3] = 0xfe00000000000000;
-        buf[4] = 0;
-        buf[5] = 0;
-        buf[6] = 0;
-        buf[7] = 1;       
-        joybus_write(buf); 
-    }), ({ joybus_read(out); }));
-}
+#define MAX_BENCHMARKS           1024
 
-xcycle_t bench_joybus_4j(benchmark_t *b) {
-    uint64_t *buf = UncachedAddr(rambuf);
-    uint64_t *out = UncachedAddr(rambuf+64);
-
-    return TIMEIT_MULTI(50, ({ 
-        buf[0] = 0xff010401ffffffff;
-        buf[1] = 0xff010401ffffffff;
-        buf[2] = 0xff010401ffffffff;
-        buf[3] = 0xff010401ffffffff;
-        buf[4] = 0xfe00000000000000;
-        buf[5] = 0;
-        buf[6] = 0;
-        buf[7] = 1;       
-        joybus_write(buf); 
-    }), ({ joybus_read(out); }));
-}
+static benchmark_t *registry[MAX_BENCHMARKS];
+static int num_registered;
 
-xcycle_t bench_joybus_access(benchmark_t *b) {
-    uint64_t *buf = UncachedAddr(rambuf);
-    uint64_t *out = UncachedAddr(rambuf+64);
-
-    return TIMEIT_MULTI(50, ({ 
-        buf[0] = 0xff010300ffffffff;
-        buf[1] = 0xfe00000000000000;
-        buf[2] = 0;
-        buf[3] = 0;
-        buf[4] = 0;
-        buf[5] = 0;
-        buf[6] = 0;
-        buf[7] = 1;       
-        joybus_write(buf); 
-    }), ({ joybus_read(out); }));
+void bench_register(benchmark_t *b) {
+    assertf(num_registered < MAX_BENCHMARKS, "too many benchmarks registered");
+    b->seq = num_registered;
+    registry[num_registered++] = b;
 }
 
-/**************************************************************************************/
-
-void bench_rsp(void)
+benchmark_t *bench_new(xcycle_t (*func)(benchmark_t*), category_t category, const char *name,
+    int qty, unit_t unit, cycletype_t cycletype, xcycle_t expected)
 {
-    volatile uint32_t t1;
-    volatile bool finish = false;
-    void sp_done(void) {
-        t1 = TICKS_READ();
-        finish = true;
+    benchmark_t *b = calloc(1, sizeof(benchmark_t));
+    b->func = func;
+    b->category = category;
+    b->name = strdup(name);
+    b->qty = qty;
+    b->unit = unit;
+    b->cycletype = cycletype;
+    b->expected = expected;
+    b->file = "";
+    bench_register(b);
+    return b;
+}
+
+static int bench_cmp(const void *pa, const void *pb) {
+    const benchmark_t *a = *(const benchmark_t**)pa;
+    const benchmark_t *b = *(const benchmark_t**)pb;
+    if (a->category != b->category) return a->category - b->category;
+    int c = strcmp(a->file, b->file);
+    if (c) return c;
+    if (a->line != b->line) return a->line - b->line;
+    return a->seq - b->seq;
+}
+
+// Categories not run by default need to be selected explicitly in the
+// config file. They are one of:
+//  * long parametric sweeps (PI-SWEEP, RDRAM-SWEEP, CONTENTION, CACHE);
+//  * tests that disturb the state the default run relies on, by enabling
+//    interrupts or reprogramming the hardware (IRQ, AI, RSPQ, JOY-ASYNC, RDP);
+//  * suites kept out of the default pass/fail table: the ungraded I/O writes
+//    (IO-W) and the VR4300 instruction latencies (CPU).
+static const struct {
+    const char *name;
+    bool by_default;
+} categories[CAT_COUNT] = {
+    [CAT_RDRAM]       = { "RDRAM",       true },
+    [CAT_RCP]         = { "RCP",         true },
+    [CAT_PI]          = { "PI",          true },
+    [CAT_SI]          = { "SI",          true },
+    [CAT_JOY]         = { "JOY",         true },
+    [CAT_JOY_ASYNC]   = { "JOY-ASYNC",   false },
+    [CAT_RSP]         = { "RSP",         true },
+    [CAT_RDP]         = { "RDP",         false },
+    [CAT_CACHE]       = { "CACHE",       false },
+    [CAT_IRQ]         = { "IRQ",         false },
+    [CAT_CPU]         = { "CPU",         false },
+    [CAT_AI]          = { "AI",          false },
+    [CAT_RSPQ]        = { "RSPQ",        false },
+    [CAT_IO_W]        = { "IO-W",        false },
+    [CAT_PI_SWEEP]    = { "PI-SWEEP",    false },
+    [CAT_RDRAM_SWEEP] = { "RDRAM-SWEEP", false },
+    [CAT_CONTENTION]  = { "CONTENTION",  false },
+};
+
+const char *category_name(category_t cat) {
+    return cat < CAT_COUNT ? categories[cat].name : "";
+}
+
+// Run configuration. Defaults can be overridden at boot by the config file
+// in the DFS image (see filesystem/systembench.cfg).
+typedef struct {
+    bool jsonl;                             // Emit JSON Lines records instead of text
+    bool subtract_overhead;                 // Subtract the TIMEIT overhead from all samples
+    stat_t judge;                           // Statistic used to grade each benchmark
+    bool batch;                             // Halt after the suite instead of showing the results UI
+    char profile[32];                       // Expectation profile (empty: pick by platform)
+    char categories[128];                   // Comma-separated categories to run (empty: all)
+    char names[256];                        // Comma-separated name prefixes to run (empty: all)
+    int profiler_hz;                        // Sampling CPU profiler frequency (0: disabled)
+} config_t;
+
+static config_t cfg = {
+    .jsonl = OUTPUT_JSONL,
+    .subtract_overhead = SUBTRACT_OVERHEAD,
+    .judge = JUDGE_STAT,
+    .batch = BATCH_MODE,
+};
+
+static char *strtrim(char *s) {
+    while (*s == ' ' || *s == '\t') s++;
+    char *end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n'))
+        *--end = 0;
+    return s;
+}
+
+void config_load(const char *fn) {
+    FILE *f = fopen(fn, "r");
+    if (!f) return;
+
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        char *key = strtrim(line);
+        if (*key == '#' || *key == 0) continue;
+        char *value = strchr(key, '=');
+        if (!value) {
+            debugf("%s: invalid line: %s\n", fn, key);
+            continue;
+        }
+        *value++ = 0;
+        key = strtrim(key);
+        value = strtrim(value);
+
+        if (!strcmp(key, "output")) {
+            cfg.jsonl = !strcmp(value, "jsonl");
+        } else if (!strcmp(key, "subtract_overhead")) {
+            cfg.subtract_overhead = atoi(value) != 0;
+        } else if (!strcmp(key, "judge")) {
+            if (!strcmp(value, "mean"))        cfg.judge = STAT_MEAN;
+            else if (!strcmp(value, "median")) cfg.judge = STAT_MEDIAN;
+            else if (!strcmp(value, "p5"))     cfg.judge = STAT_P5;
+            else if (!strcmp(value, "p95"))    cfg.judge = STAT_P95;
+            else debugf("%s: invalid judge: %s\n", fn, value);
+        } else if (!strcmp(key, "batch")) {
+            cfg.batch = atoi(value) != 0;
+        } else if (!strcmp(key, "profile")) {
+            strlcpy(cfg.profile, value, sizeof(cfg.profile));
+        } else if (!strcmp(key, "categories")) {
+            strlcpy(cfg.categories, value, sizeof(cfg.categories));
+        } else if (!strcmp(key, "names")) {
+            strlcpy(cfg.names, value, sizeof(cfg.names));
+        } else if (!strcmp(key, "profiler")) {
+            cfg.profiler_hz = atoi(value);
+        } else {
+            debugf("%s: unknown key: %s\n", fn, key);
+        }
     }
+    fclose(f);
+}
+
+// Check whether str matches any entry of a comma-separated list. Entries
+// are compared case-insensitively; with prefix=true, they only need to match
+// the beginning of str.
+static bool list_match(const char *list, const char *str, bool prefix) {
+    while (*list) {
+        while (*list == ',' || *list == ' ') list++;
+        const char *end = strchr(list, ',');
+        if (!end) end = list + strlen(list);
+        int len = end - list;
+        while (len > 0 && list[len-1] == ' ') len--;
+        if (len > 0 && !strncasecmp(list, str, len) && (prefix || str[len] == 0))
+            return true;
+        list = end;
+    }
+    return false;
+}
 
-    register_SP_handler(sp_done);
-    rsp_load(&rsp_bench);
-
-    enable_interrupts();
-    uint32_t t0 = TICKS_READ();
-    rsp_run_async();
-    while (!finish) {}
-
-    disable_interrupts();
-    unregister_SP_handler(sp_done);
-    debugf("RSP loop:    %7ld cycles\n", TICKS_DISTANCE(t0, t1));
+bool bench_selected(benchmark_t *b) {
+    if (cfg.categories[0] ? !list_match(cfg.categories, category_name(b->category), false)
+                          : !categories[b->category].by_default)
+        return false;
+    if (cfg.names[0] && !list_match(cfg.names, b->name, true))
+        return false;
+    return true;
 }
 
 const char *cycletype_name(cycletype_t ct) {
@@ -536,6 +308,56 @@ int64_t xcycle_to_cycletype(xcycle_t cycles, cycletype_t ct) {
     }
 }
 
+xcycle_t xcycle_from_cycletype(int64_t cycles, cycletype_t ct) {
+    switch (ct) {
+    case CYCLE_COP0: return XCYCLE_FROM_COP0(cycles);
+    case CYCLE_CPU: return XCYCLE_FROM_CPU(cycles);
+    case CYCLE_RCP: return XCYCLE_FROM_RCP(cycles);
+    default: return 0;
+    }
+}
+
+// Load an expectation profile, overriding the builtin expected values. Each
+// line is "name, qty, cycles" with cycles in the benchmark's cycle type.
+// Returns false if the profile does not exist.
+bool profile_load(const char *fn) {
+    FILE *f = fopen(fn, "r");
+    if (!f) return false;
+
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        char *name = strtrim(line);
+        if (*name == '#' || *name == 0) continue;
+
+        // Names can contain spaces but not commas, so split on the last two
+        char *cycles = strrchr(name, ',');
+        if (!cycles) goto invalid;
+        *cycles++ = 0;
+        char *qty = strrchr(name, ',');
+        if (!qty) goto invalid;
+        *qty++ = 0;
+        name = strtrim(name);
+
+        bool found = false;
+        for (int i=0;i<num_registered;i++) {
+            benchmark_t *b = registry[i];
+            if (b->qty == atoi(qty) && !strcmp(b->name, name)) {
+                b->expected = xcycle_from_cycletype(atoll(cycles), b->cycletype);
+                found = true;
+            }
+        }
+        if (!found && !cfg.jsonl)
+            debugf("%s: unknown benchmark: %s [%d]\n", fn, name, atoi(qty));
+        continue;
+
+    invalid:
+        if (!cfg.jsonl)
+            debugf("%s: invalid line: %s\n", fn, name);
+    }
+    fclose(f);
+    return true;
+}
+
 void format_speed(char *buf, int nbytes, xcycle_t time) {
     if (time == 0) {
         sprintf(buf, "inf");
@@ -551,77 +373,204 @@ void format_speed(char *buf, int nbytes, xcycle_t time) {
     }
 }
 
+void dump_stats(benchmark_t *b) {
+    stats_t *st = &b->stats;
+    debugf("Stats:     median %lld, p5 %lld, p95 %lld, stddev %lld, ci95 +/-%lld (%d samples)\n",
+        xcycle_to_cycletype(st->median, b->cycletype),
+        xcycle_to_cycletype(st->p5, b->cycletype),
+        xcycle_to_cycletype(st->p95, b->cycletype),
+        xcycle_to_cycletype(st->stddev, b->cycletype),
+        xcycle_to_cycletype(st->ci95, b->cycletype),
+        st->n);
+    for (int i=0;i<STATS_HIST_BUCKETS;i++) {
+        if (!st->hist[i]) continue;
+        debugf("           [%7lld..%7lld] %3d\n",
+            xcycle_to_cycletype(st->min + st->hist_width*i, b->cycletype),
+            xcycle_to_cycletype(st->min + st->hist_width*(i+1) - 1, b->cycletype),
+            st->hist[i]);
+    }
+}
+
+const char *bucket_name(benchmark_t *b) {
+    if (b->passed_0p)  return "0p";
+    if (b->passed_5p)  return "5p";
+    if (b->passed_10p) return "10p";
+    if (b->passed_30p) return "30p";
+    if (!b->expected)  return "none";
+    return "fail";
+}
+
+// Dump a benchmark result as a single JSON line. The record is assembled in
+// memory and sent with a single write, so that it is never interleaved with
+// other output and costs one round-trip on slow channels like ISViewer.
+// All cycle counts are expressed in the benchmark's own cycle type.
+void emit_jsonl(benchmark_t *b) {
+    static char buf[4096];
+    int n = 0;
+
+    #define APPEND(fmt, ...) \
+        if (n < sizeof(buf)) n += snprintf(buf+n, sizeof(buf)-n, fmt, ##__VA_ARGS__)
+
+    APPEND("{\"category\":\"%s\",\"name\":\"", category_name(b->category));
+    for (const char *c = b->name; *c; c++) {
+        if (*c == '"' || *c == '\\') APPEND("\\");
+        APPEND("%c", *c);
+    }
+    APPEND("\",\"qty\":%d,\"cycletype\":\"%s\",\"expected\":%lld,\"found\":%lld,\"bucket\":\"%s\",\"samples\":[",
+        b->qty, cycletype_name(b->cycletype),
+        xcycle_to_cycletype(b->expected, b->cycletype),
+        xcycle_to_cycletype(b->found, b->cycletype),
+        bucket_name(b));
+    for (int i=0;i<last_num_samples;i++)
+        APPEND(i ? ",%lld" : "%lld", xcycle_to_cycletype(last_samples[i], b->cycletype));
+    APPEND("]");
+    if (b->stats.n) {
+        stats_t *st = &b->stats;
+        APPEND(",\"median\":%lld,\"p5\":%lld,\"p95\":%lld,\"stddev\":%lld,\"ci95\":%lld,\"hist_width\":%lld,\"hist\":[",
+            xcycle_to_cycletype(st->median, b->cycletype),
+            xcycle_to_cycletype(st->p5, b->cycletype),
+            xcycle_to_cycletype(st->p95, b->cycletype),
+            xcycle_to_cycletype(st->stddev, b->cycletype),
+            xcycle_to_cycletype(st->ci95, b->cycletype),
+            xcycle_to_cycletype(st->hist_width, b->cycletype));
+        for (int i=0;i<STATS_HIST_BUCKETS;i++)
+            APPEND(i ? ",%d" : "%d", st->hist[i]);
+        APPEND("]");
+    }
+    APPEND("}\n");
+
+    #undef APPEND
+
+    if (n >= sizeof(buf)) {
+        // Truncated record: terminate it anyway so that the stream stays line-based
+        buf[sizeof(buf)-2] = '\n';
+        n = sizeof(buf)-1;
+    }
+    // Bypass stdio, which does not guarantee a single write even unbuffered
+    fflush(stderr);
+    write(STDERR_FILENO, buf, n);
+}
+
+// Measure the cost of timing an empty statement with each TIMEIT variant.
+// The median is used as overhead, while the spread of the samples around it
+// is the residual error that no subtraction can remove.
+void timeit_calibrate(bool subtract) {
+    timeit_overhead = timeit_while_overhead = 0;
+
+    (void)TIMEIT_MULTI(100, ({ }), ({ }));
+    xcycle_t overhead = last_stats.median;
+    xcycle_t residual = last_stats.p95 - last_stats.p5;
+
+    (void)TIMEIT_WHILE_MULTI(100, ({ }), ({ }), ({ false; }));
+    xcycle_t while_overhead = last_stats.median;
+    if (last_stats.p95 - last_stats.p5 > residual)
+        residual = last_stats.p95 - last_stats.p5;
+
+    // The residual widens the grading tolerance only when the overhead is
+    // subtracted; otherwise the builtin tolerances are kept, and it is just
+    // reported.
+    timeit_residual = 0;
+    if (subtract) {
+        timeit_overhead = overhead;
+        timeit_while_overhead = while_overhead;
+        timeit_residual = residual;
+    }
+
+    if (!cfg.jsonl) {
+        debugf("TIMEIT overhead:       %3lld CPU cycles\n", xcycle_to_cycletype(overhead, CYCLE_CPU));
+        debugf("TIMEIT_WHILE overhead: %3lld CPU cycles\n", xcycle_to_cycletype(while_overhead, CYCLE_CPU));
+        debugf("Residual error:        %3lld CPU cycles (%s)\n", xcycle_to_cycletype(residual, CYCLE_CPU),
+            subtract ? "overhead subtracted" : "overhead not subtracted");
+    } else {
+        debugf("{\"calibration\":{\"timeit\":%lld,\"timeit_while\":%lld,\"residual\":%lld,\"subtracted\":%s}}\n",
+            xcycle_to_cycletype(overhead, CYCLE_CPU),
+            xcycle_to_cycletype(while_overhead, CYCLE_CPU),
+            xcycle_to_cycletype(residual, CYCLE_CPU),
+            subtract ? "true" : "false");
+    }
+}
+
+// Final record for unattended runs. The last line is a fixed marker that
+// the runner can wait for before stopping the emulator.
+void emit_summary(int total, int p0, int p5, int p10, int p30, int failed, int ungraded) {
+    if (cfg.jsonl) {
+        debugf("{\"summary\":{\"platform\":\"%s\",\"profile\":\"%s\",\"total\":%d,\"0p\":%d,\"5p\":%d,\"10p\":%d,\"30p\":%d,\"fail\":%d,\"none\":%d}}\n",
+            sys_bbplayer() ? "iQue" : "N64", cfg.profile, total, p0, p5, p10, p30, failed, ungraded);
+    } else {
+        debugf("Summary: %s, profile %s, %d tests, 0%%: %d, 5%%: %d, 10%%: %d, 30%%: %d, failed: %d, not graded: %d\n",
+            sys_bbplayer() ? "iQue" : "N64", cfg.profile, total, p0, p5, p10, p30, failed, ungraded);
+    }
+    debugf("%s\n", BATCH_DONE_MARKER);
+}
+
 int main(void)
 {
-    benchmark_t benchs[] = {
-        { bench_ram_cached_r8,  "RDRAM C8R",     1,   UNIT_BYTES, CYCLE_CPU,  XCYCLE_FROM_CPU(3) },
-        { bench_ram_cached_r16, "RDRAM C16R",    2,   UNIT_BYTES, CYCLE_CPU,  XCYCLE_FROM_CPU(3) },
-        { bench_ram_cached_r32, "RDRAM C32R",    4,   UNIT_BYTES, CYCLE_CPU,  XCYCLE_FROM_CPU(3) },
-        { bench_ram_cached_r64, "RDRAM C64R",    8,   UNIT_BYTES, CYCLE_CPU,  XCYCLE_FROM_CPU(3) },
-
-        { bench_ram_uncached_r8,  "RDRAM U8R",     1,   UNIT_BYTES, CYCLE_CPU,  XCYCLE_FROM_CPU(34) },
-        { bench_ram_uncached_r16, "RDRAM U16R",    2,   UNIT_BYTES, CYCLE_CPU,  XCYCLE_FROM_CPU(34) },
-        { bench_ram_uncached_r32, "RDRAM U32R",    4,   UNIT_BYTES, CYCLE_CPU,  XCYCLE_FROM_CPU(34) },
-        { bench_ram_uncached_r64, "RDRAM U64R",    8,   UNIT_BYTES, CYCLE_CPU,  XCYCLE_FROM_CPU(37) },
-
-        { bench_ram_uncached_r32_seq,       "RDRAM U32R seq",    4*4,   UNIT_BYTES, CYCLE_CPU,  XCYCLE_FROM_CPU(134) },
-        { bench_ram_uncached_r32_random,    "RDRAM U32R rand",   4*4,   UNIT_BYTES, CYCLE_CPU,  XCYCLE_FROM_CPU(134) },
-        { bench_ram_uncached_r32_multibank, "RDRAM U32R banked", 4*4,   UNIT_BYTES, CYCLE_CPU,  XCYCLE_FROM_CPU(136) },
-
-        { bench_rcp_io_r, "RCP I/O R",    1,   UNIT_BYTES, CYCLE_CPU,  XCYCLE_FROM_CPU(24) },
-        // { bench_rcp_io_w, "RCP I/O W",   1,   UNIT_BYTES, CYCLE_CPU,  XCYCLE_FROM_CPU(193) },  // FIXME: flush buffer
-
-        { bench_pidma, "PI DMA",        8,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(193) },
-        { bench_pidma, "PI DMA",      128,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(1591) },
-        { bench_pidma, "PI DMA",     1024,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(12168) },
-        { bench_pidma, "PI DMA",  64*1024,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(777807) },
-
-        { bench_piior, "PI I/O R",   4,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(144) },
-        { bench_piiow, "PI I/O W",   4,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(134) },
-
-        { bench_sidmaw_ram, "SI DMA W RAM",  64,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(4065) },
-        { bench_sidmaw_rom, "SI DMA W ROM",  64,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(2144) },
-        { bench_siior, "SI I/O R",   4,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(1974) },
-        { bench_siiow, "SI I/O W",   4,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(2158) },
-
-        { bench_joybus_empty0,  "JOY: Empty 0B",    64,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(15030) },
-        { bench_joybus_empty0b, "JOY: Empty 1B",    64,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(16424) },
-        { bench_joybus_empty0c, "JOY: Empty 4B",    64,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(20644) },
-        { bench_joybus_empty1,  "JOY: Empty 8B",    64,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(21163) },
-        { bench_joybus_empty4,  "JOY: Empty 32B",   64,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(21163) },
-        { bench_joybus_empty7,  "JOY: Empty 56B",   64,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(21170) },
-        { bench_joybus_empty7e, "JOY: Empty 63B",   64,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(21178) },
-        { bench_joybus_1j,      "JOY: 1J",       64,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(37987) },
-        { bench_joybus_2j,      "JOY: 2J",       64,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(57972) },
-        { bench_joybus_3j,      "JOY: 3J",       64,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(77924) },
-        { bench_joybus_4j,      "JOY: 4J",       64,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(97890) },
-        { bench_joybus_access,  "JOY: Accessory",64,   UNIT_BYTES, CYCLE_RCP,  XCYCLE_FROM_RCP(36834) },
-    };
-
     rsp_init();
     debug_init_isviewer();
     debug_init_usblog();
-    debugf("n64-systembench is alive\n");
+
+    bool has_dfs = dfs_init(DFS_DEFAULT_LOCATION) == DFS_ESUCCESS;
+    if (has_dfs)
+        config_load("rom:/systembench.cfg");
+
+    // In JSONL mode, every line on the log must be a JSON record
+    if (!cfg.jsonl)
+        debugf("n64-systembench is alive\n");
+
+    // Without an explicit profile, pick the one matching the platform. If it
+    // does not exist, the builtin expected values are used.
+    if (!cfg.profile[0])
+        strlcpy(cfg.profile, sys_bbplayer() ? "ique" : "n64", sizeof(cfg.profile));
+    char profile_fn[64];
+    snprintf(profile_fn, sizeof(profile_fn), "rom:/expected/%s.txt", cfg.profile);
+    if (!has_dfs || !profile_load(profile_fn)) {
+        if (!cfg.jsonl)
+            debugf("Expectation profile not found: %s (using builtin values)\n", cfg.profile);
+        strlcpy(cfg.profile, "builtin", sizeof(cfg.profile));
+    }
+
+    // Collect the benchmarks selected by the configuration, in registry order
+    static benchmark_t *benchs[MAX_BENCHMARKS];
+    int num_benches = 0;
+    qsort(registry, num_registered, sizeof(benchmark_t*), bench_cmp);
+    for (int i=0;i<num_registered;i++)
+        if (bench_selected(registry[i]))
+            benchs[num_benches++] = registry[i];
+    assertf(num_benches > 0, "No benchmark selected\ncategories=%s\nnames=%s", cfg.categories, cfg.names);
+
+    // The profiler samples only while interrupts are enabled, that is within
+    // the benchmarks that enable them (eg: RSPQ, JOY-ASYNC).
+    if (cfg.profiler_hz) {
+        timer_init();
+        profiler_start(cfg.profiler_hz);
+    }
 
     // Disable interrupts. VI is already disabled, so the RCP should be pretty idle
     // now. We could add some asserts to make sure that all peripherals are idle at this point.
     disable_interrupts();
     VI_regs->control = 0;
 
+    judge_stat = cfg.judge;
+    timeit_calibrate(cfg.subtract_overhead);
+
     int passed_0p  = 0;
     int passed_5p  = 0;
     int passed_10p = 0;
     int passed_30p = 0;
     int failed     = 0;
-    const int num_benches = sizeof(benchs) / sizeof(benchmark_t);
+    int ungraded   = 0;
     for (int i=0;i<num_benches;i++) {
-        benchmark_t* b = &benchs[i];
+        benchmark_t* b = benchs[i];
 
-        debugf("*** %s [%d]\n", b->name, b->qty);
+        if (!cfg.jsonl)
+            debugf("*** %s [%d]\n", b->name, b->qty);
         // wait_ms(100);
 
         // Run the benchmark
+        last_num_samples = 0;
+        memset(&last_stats, 0, sizeof(last_stats));
         xcycle_t cycles = b->func(b);
+        b->stats = last_stats;
 
         // Truncate the found value, depending on the exact cycle type it should be expressed in.
         switch (b->cycletype) {
@@ -635,35 +584,68 @@ int main(void)
         int64_t expected = xcycle_to_cycletype(b->expected, b->cycletype);
         int64_t found    = xcycle_to_cycletype(b->found,    b->cycletype);
 
-        char exp_speed[128]={0}, found_speed[128]={0};
-        format_speed(exp_speed,   b->qty, b->expected);
-        format_speed(found_speed, b->qty, b->found);
+        if (!cfg.jsonl) {
+            char exp_speed[128]={0}, found_speed[128]={0};
+            if (b->unit == UNIT_BYTES) {
+                format_speed(exp_speed,   b->qty, b->expected);
+                format_speed(found_speed, b->qty, b->found);
+            } else {
+                strcpy(exp_speed, "-");
+                strcpy(found_speed, "-");
+            }
 
-        debugf("Expected:  %7lld %s cycles     (%s)\n", expected, cycletype_name(b->cycletype), exp_speed);
-        // wait_ms(100);
-        debugf("Found:     %7lld %s cycles     (%s)\n", found,    cycletype_name(b->cycletype), found_speed);
-        // wait_ms(100);
-        debugf("Diff:      %+7lld (%+02.1f%%)\n", found - expected, (float)(found - expected) * 100.0f / (float)expected);
-        // wait_ms(100);
+            if (b->expected) {
+                debugf("Expected:  %7lld %s cycles     (%s)\n", expected, cycletype_name(b->cycletype), exp_speed);
+                // wait_ms(100);
+            }
+            debugf("Found:     %7lld %s cycles     (%s)\n", found,    cycletype_name(b->cycletype), found_speed);
+            // wait_ms(100);
+            if (b->expected) {
+                debugf("Diff:      %+7lld (%+02.1f%%)\n", found - expected, (float)(found - expected) * 100.0f / (float)expected);
+                // wait_ms(100);
+            }
+            if (b->stats.n)
+                dump_stats(b);
+        }
 
-        int meas_error = xcycle_to_cycletype((b->cycletype == CYCLE_RCP) ? MEASUREMENT_ERROR_RCP : MEASUREMENT_ERROR_CPU, b->cycletype);
+        xcycle_t meas_error_x = (b->cycletype == CYCLE_RCP) ? MEASUREMENT_ERROR_RCP : MEASUREMENT_ERROR_CPU;
+        if (timeit_residual > meas_error_x) meas_error_x = timeit_residual;
+        int meas_error = xcycle_to_cycletype(meas_error_x, b->cycletype);
 
+        // Benchmarks without an expected value (e.g. sweeps) are only measured
         int diff = found - expected;
         if (diff < 0) diff = -diff;
         float pdiff = (float)diff * 100.0f / (float)expected;
-        if (diff <= meas_error || pdiff < 0.2f)  b->passed_0p  = true, passed_0p++;
+        if (!b->expected) ungraded++;
+        else if (diff <= meas_error || pdiff < 0.2f)  b->passed_0p  = true, passed_0p++;
         else if (diff <= meas_error || pdiff < 5.0f)  b->passed_5p  = true, passed_5p++;
         else if (diff <= meas_error || pdiff < 10.0f) b->passed_10p = true, passed_10p++;
         else if (diff <= meas_error || pdiff < 30.0f) b->passed_30p = true, passed_30p++;
         else failed++;
+
+        if (cfg.jsonl)
+            emit_jsonl(b);
     }
 
     enum { BENCH_PER_PAGE = 20 };
-    uint32_t colors[5] = { 0xffffffff, 0x8fb93500, 0xe6e22e00, 0xe09c3b00, 0xe6474700 };
+    uint32_t colors[6] = { 0xffffffff, 0x8fb93500, 0xe6e22e00, 0xe09c3b00, 0xe6474700, 0x90909000 };
     int page = 0;
     int num_pages = 1 + (num_benches + BENCH_PER_PAGE - 1) / BENCH_PER_PAGE;
 
-    debugf("Benchmarks done\n");
+    if (!cfg.jsonl)
+        debugf("Benchmarks done\n");
+
+    if (cfg.profiler_hz) {
+        profiler_stop();
+        profiler_dump();
+    }
+
+    if (cfg.batch) {
+        emit_summary(num_benches, passed_0p, passed_5p, passed_10p, passed_30p, failed, ungraded);
+        // Park the CPU in a branch-to-self with interrupts disabled. Emulators
+        // can detect this idle loop, and nothing else will run after it.
+        while (1) {}
+    }
     
     // ack all pending interrupts
     SI_regs->status = SI_WSTATUS_INTACK;
@@ -694,8 +676,11 @@ int main(void)
             sprintf(sbuf, "Platform: %s", sys_bbplayer() ? "iQue" : "N64");
             graphics_draw_text(disp, 270-15, 40, sbuf);
 
+            sprintf(sbuf, "Profile: %s", cfg.profile);
+            graphics_draw_text(disp, 270-15, 50, sbuf);
+
             sprintf(sbuf, "Tests: %d", num_benches);
-            graphics_draw_text(disp, 270, 50, sbuf);
+            graphics_draw_text(disp, 270, 60, sbuf);
 
             graphics_draw_text(disp, 200, 70, "Results:");
 
@@ -719,6 +704,12 @@ int main(void)
             sprintf(sbuf, "     Failed: %2d (%3d %%)", failed, failed * 100 / num_benches);
             graphics_draw_text(disp, 200, 120, sbuf);
 
+            if (ungraded) {
+                graphics_set_color(colors[5], 0);
+                sprintf(sbuf, " Not graded: %2d (%3d %%)", ungraded, ungraded * 100 / num_benches);
+                graphics_draw_text(disp, 200, 130, sbuf);
+            }
+
             graphics_set_color(0xFFFFFFFF, 0);
 
             graphics_draw_text(disp, 320-110, 140, "Press L/R to navigate pages");
@@ -730,7 +721,7 @@ int main(void)
             for (int i=0;i<BENCH_PER_PAGE;i++) {
                 int idx = i + (page-1)*BENCH_PER_PAGE;
                 if (idx >= num_benches) break;
-                benchmark_t* b = &benchs[idx];
+                benchmark_t* b = benchs[idx];
                 int64_t expected = xcycle_to_cycletype(b->expected, b->cycletype);
                 int64_t found    = xcycle_to_cycletype(b->found,    b->cycletype);
 
@@ -738,11 +729,16 @@ int main(void)
                 else if (b->passed_5p)  graphics_set_color(colors[1], 0);
                 else if (b->passed_10p) graphics_set_color(colors[2], 0);
                 else if (b->passed_30p) graphics_set_color(colors[3], 0);
+                else if (!b->expected)  graphics_set_color(colors[5], 0);
                 else                    graphics_set_color(colors[4], 0);
 
-                sprintf(sbuf, "%20s %7d | %4s | %7lld | %7lld | %+7lld (%+02.1f%%)",
-                    b->name, b->qty, cycletype_name(b->cycletype),
-                    expected, found, found-expected, (float)(found - expected) * 100.0f / (float)expected);
+                if (b->expected)
+                    sprintf(sbuf, "%20s %7d | %4s | %7lld | %7lld | %+7lld (%+02.1f%%)",
+                        b->name, b->qty, cycletype_name(b->cycletype),
+                        expected, found, found-expected, (float)(found - expected) * 100.0f / (float)expected);
+                else
+                    sprintf(sbuf, "%20s %7d | %4s | %7s | %7lld |",
+                        b->name, b->qty, cycletype_name(b->cycletype), "-", found);
                 graphics_draw_text(disp, 20, y, sbuf);
                 y += 10;
             }
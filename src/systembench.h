@@ -0,0 +1,292 @@
+#ifndef SYSTEMBENCH_H
+#define SYSTEMBENCH_H
+
+#include <stdio.h>
+#include <string.h>
+#include <libdragon.h>
+#include "../libdragon/include/regsinternal.h"
+
+typedef uint64_t xcycle_t;
+
+#define RCP_FREQUENCY            62500000              // N64 & iQue
+#define RCP_FACTOR               9                     // Scaling factor to convert to xcycle
+#define CPU_FACTOR               (RCP_FREQUENCY * RCP_FACTOR / CPU_FREQUENCY)   // CPU Scaling factor (different N64 vs iQue)
+#define COP0_FACTOR              (CPU_FACTOR * 2)
+
+#define XCYCLES_PER_SECOND       XCYCLE_FROM_CPU(CPU_FREQUENCY)
+#define XCYCLE_FROM_COP0(t)      ((t) * COP0_FACTOR)
+#define XCYCLE_FROM_CPU(t)       ((t) * CPU_FACTOR)
+#define XCYCLE_FROM_RCP(t)       ((t) * RCP_FACTOR)
+
+#define MEASUREMENT_ERROR_CPU    XCYCLE_FROM_CPU(1)    // Sampling error when measuring CPU cycles
+#define MEASUREMENT_ERROR_RCP    XCYCLE_FROM_CPU(4)    // Sampling error when measuring RCP cycles
+
+// Emit one JSON Lines record per benchmark instead of the human-readable
+// dump. Build with "make JSONL=1" to turn it on.
+#ifndef OUTPUT_JSONL
+#define OUTPUT_JSONL             0
+#endif
+
+// Statistic of the sample distribution used to grade each benchmark.
+// Override with e.g. "make JUDGE=STAT_MEDIAN", or set "judge = median" in
+// the config file.
+#ifndef JUDGE_STAT
+#define JUDGE_STAT               STAT_MEAN
+#endif
+
+// Adaptive sampling: TIMEIT_MULTI keeps sampling until the 95% confidence
+// interval of the mean is narrow enough, or the time budget is exhausted.
+// The sample count passed to TIMEIT_MULTI is ignored in this mode.
+// Build with "make ADAPTIVE=1" to turn it on.
+#ifndef ADAPTIVE_SAMPLING
+#define ADAPTIVE_SAMPLING        0
+#endif
+// Subtract the measured instrumentation overhead from all samples. Build with
+// "make SUBTRACT_OVERHEAD=1", or set "subtract_overhead = 1" in the config file.
+#ifndef SUBTRACT_OVERHEAD
+#define SUBTRACT_OVERHEAD        0
+#endif
+
+// Batch mode: once the suite is done, emit a summary and a completion marker,
+// then halt instead of entering the interactive results UI.
+// Build with "make BATCH=1", or set "batch = 1" in the config file.
+#ifndef BATCH_MODE
+#define BATCH_MODE               0
+#endif
+#define BATCH_DONE_MARKER        "@@SYSTEMBENCH-DONE@@"
+
+#define ADAPTIVE_MIN_SAMPLES     10
+#define ADAPTIVE_TARGET_PCT      0.5f                  // Target CI half-width, relative to the mean
+#define ADAPTIVE_BUDGET_MS       500                   // Time budget per TIMEIT_MULTI
+
+
+typedef enum {
+    CYCLE_RCP,
+    CYCLE_CPU,
+    CYCLE_COP0,
+} cycletype_t;
+
+typedef enum {
+    UNIT_BYTES,         // qty is the number of bytes transferred
+    UNIT_STRIDE,        // qty is the stride in bytes between accesses
+    UNIT_OPS,           // qty is the number of operations
+    UNIT_PIXELS,        // qty is the number of pixels drawn
+} unit_t;
+
+typedef enum {
+    STAT_MEAN,          // Mean without the min and max samples
+    STAT_MEDIAN,
+    STAT_P5,
+    STAT_P95,
+} stat_t;
+
+#define STATS_HIST_BUCKETS       8
+
+// Distribution of the samples of a TIMEIT_MULTI run (all values in xcycles)
+typedef struct {
+    int n;
+    xcycle_t min, max;
+    xcycle_t mean;
+    xcycle_t median, p5, p95;
+    xcycle_t stddev;
+    xcycle_t ci95;                          // Half-width of the 95% confidence interval of the mean
+    xcycle_t hist_width;                    // Width of each histogram bucket, starting at min
+    int hist[STATS_HIST_BUCKETS];
+} stats_t;
+
+typedef enum {
+    CAT_RDRAM,
+    CAT_RCP,
+    CAT_PI,
+    CAT_SI,
+    CAT_JOY,
+    CAT_JOY_ASYNC,
+    CAT_RSP,
+    CAT_RDP,
+    CAT_CACHE,
+    CAT_IRQ,
+    CAT_CPU,
+    CAT_AI,
+    CAT_RSPQ,
+    CAT_IO_W,
+    CAT_PI_SWEEP,
+    CAT_RDRAM_SWEEP,
+    CAT_CONTENTION,
+    CAT_COUNT
+} category_t;
+
+struct benchmark_s;
+typedef struct benchmark_s benchmark_t;
+
+typedef struct benchmark_s {
+    xcycle_t (*func)(benchmark_t* b);
+    category_t category;
+    const char *name;
+    int qty;
+    unit_t unit;
+    cycletype_t cycletype;
+
+    xcycle_t expected;
+    float tolerance;
+    xcycle_t found;
+    stats_t stats;
+    bool passed_0p, passed_5p, passed_10p, passed_30p;
+
+    int args[4];                            // Parameters of parametric benchmarks
+
+    const char *file;                       // Registration site, used to sort the registry
+    int line;
+    int seq;
+} benchmark_t;
+
+void bench_register(benchmark_t *b);
+
+// Allocate and register a benchmark at runtime. This is meant for parametric
+// sweeps, which register many points from a single constructor. Pass 0 as
+// expected value for points that are only measured and never graded.
+benchmark_t *bench_new(xcycle_t (*func)(benchmark_t*), category_t category, const char *name,
+    int qty, unit_t unit, cycletype_t cycletype, xcycle_t expected);
+
+// Register a benchmark. Registration happens in a global constructor, so that
+// each benchmark can be declared next to its implementation in any source file.
+// The registry is sorted by category, and then by registration site. The entry
+// is filled at runtime because XCYCLE_FROM_CPU depends on the platform.
+#define BENCHMARK(func, category, name, qty, unit, cycletype, expected) \
+    __BENCHMARK(__COUNTER__, func, category, name, qty, unit, cycletype, expected)
+#define __BENCHMARK(id, ...)   __BENCHMARK2(id, __VA_ARGS__)
+#define __BENCHMARK2(id, _func, _category, _name, _qty, _unit, _cycletype, _expected) \
+    __attribute__((constructor)) static void __bench_register_##id(void) { \
+        static benchmark_t b; \
+        b = (benchmark_t){ .func = _func, .category = _category, .name = _name, .qty = _qty, \
+            .unit = _unit, .cycletype = _cycletype, .expected = _expected, \
+            .file = __FILE__, .line = __LINE__ }; \
+        bench_register(&b); \
+    }
+
+extern uint8_t rambuf[1024*1024];
+
+static volatile struct VI_regs_s * const VI_regs = (struct VI_regs_s *)0xa4400000;
+static volatile struct PI_regs_s * const PI_regs = (struct PI_regs_s *)0xa4600000;
+static volatile struct SI_regs_s * const SI_regs = (struct SI_regs_s *)0xa4800000;
+
+static volatile void * const PIF_ROM = (void *)0x1fc00700;
+static volatile void * const PIF_RAM = (void *)0x1fc007c0;
+
+#define PI_STATUS_DMA_BUSY ( 1 << 0 )
+#define PI_STATUS_IO_BUSY  ( 1 << 1 )
+
+#define SI_STATUS_DMA_BUSY ( 1 << 0 )
+#define SI_STATUS_IO_BUSY  ( 1 << 1 )
+#define SI_WSTATUS_INTACK  0
+
+// Internal to libdragon (joybusinternal.h)
+void joybus_exec_async(const void * input, void (*callback)(uint64_t *output, void *ctx), void *ctx);
+
+// DP command registers: start, end, current, status, clock, cmd busy,
+// pipe busy, tmem
+static volatile uint32_t * const DP_regs = (uint32_t *)0xa4100000;
+
+#define DP_STATUS_PIPE_BUSY      (1 << 5)
+#define DP_STATUS_DMA_BUSY       (1 << 8)
+#define DP_STATUS_END_VALID      (1 << 9)
+#define DP_STATUS_START_VALID    (1 << 10)
+
+#define DP_WSTATUS_CLR_XBUS      (1 << 0)
+#define DP_WSTATUS_CLR_FREEZE    (1 << 2)
+#define DP_WSTATUS_CLR_FLUSH     (1 << 4)
+#define DP_WSTATUS_CLR_TMEM_CTR  (1 << 6)
+#define DP_WSTATUS_CLR_PIPE_CTR  (1 << 7)
+#define DP_WSTATUS_CLR_CMD_CTR   (1 << 8)
+#define DP_WSTATUS_CLR_CLOCK_CTR (1 << 9)
+
+// Fixed cost of the TIMEIT / TIMEIT_WHILE instrumentation itself, measured at
+// startup by timeit_calibrate(). It is subtracted from every sample only when
+// overhead subtraction is enabled (see SUBTRACT_OVERHEAD), as the expected
+// values of the builtin benchmarks include it.
+extern xcycle_t timeit_overhead, timeit_while_overhead;
+
+static inline xcycle_t timeit_sub(xcycle_t t, xcycle_t overhead) {
+    return t > overhead ? t - overhead : 0;
+}
+
+#define TIMEIT(setup, stmt) ({ \
+    MEMORY_BARRIER(); \
+    setup; \
+    uint32_t __t0 = TICKS_READ(); \
+    stmt; \
+    uint32_t __t1 = TICKS_READ(); \
+    MEMORY_BARRIER(); \
+    timeit_sub(XCYCLE_FROM_COP0(TICKS_DISTANCE(__t0, __t1)), timeit_overhead); \
+})
+
+#define TIMEIT_WHILE(setup, stmt, cond) ({ \
+    register uint32_t __t1,__t2,__t3,__t4,__t5,__t6, __t7, __t8; \
+    register bool __c1, __c2, __c3, __c4, __c5, __c6, __c7, __c8; \
+    MEMORY_BARRIER(); \
+    setup; \
+    uint32_t __t0 = TICKS_READ(); \
+    stmt; \
+    do { \
+        __t1 = TICKS_READ(); __c1 = (cond); \
+        __t2 = TICKS_READ(); __c2 = (cond); \
+        __t3 = TICKS_READ(); __c3 = (cond); \
+        __t4 = TICKS_READ(); __c4 = (cond); \
+        __t5 = TICKS_READ(); __c5 = (cond); \
+        __t6 = TICKS_READ(); __c6 = (cond); \
+        __t7 = TICKS_READ(); __c7 = (cond); \
+        __t8 = TICKS_READ(); __c8 = (cond); \
+    } while (__c8); \
+    uint32_t __tend; \
+    if (!__c1) __tend = __t1; \
+    else if (!__c2) __tend = __t2; \
+    else if (!__c3) __tend = __t3; \
+    else if (!__c4) __tend = __t4; \
+    else if (!__c5) __tend = __t5; \
+    else if (!__c6) __tend = __t6; \
+    else if (!__c7) __tend = __t7; \
+    else __tend = __t8; \
+    MEMORY_BARRIER(); \
+    timeit_sub(XCYCLE_FROM_COP0(TICKS_DISTANCE(__t0, __tend)), timeit_while_overhead); \
+})
+
+// Raw samples of a single TIMEIT_MULTI run are capped to this amount
+#define MAX_SAMPLES              256
+
+xcycle_t timeit_stats(xcycle_t *samples, int n);
+
+// Convert the result of a TIMEIT_MULTI run that timed a loop into the cost of
+// a single iteration. The recorded samples and statistics are scaled as well.
+xcycle_t timeit_per_iter(xcycle_t total, int iters);
+
+typedef struct {
+    int n;
+    double sum, sum2;
+    uint32_t t0;
+} adaptive_t;
+
+static inline void adaptive_begin(adaptive_t *a) {
+    memset(a, 0, sizeof(*a));
+    a->t0 = TICKS_READ();
+}
+
+bool adaptive_done(adaptive_t *a, xcycle_t sample);
+
+// Collect up to n samples of an expression evaluating to an xcycle_t (or
+// until adaptive sampling is satisfied), and return the selected statistic.
+#define SAMPLE_MULTI(n, sample) ({ \
+    int __n = ADAPTIVE_SAMPLING ? MAX_SAMPLES : (n); \
+    xcycle_t __samples[__n]; \
+    adaptive_t __a; adaptive_begin(&__a); \
+    int __i = 0; \
+    do __samples[__i] = (sample); \
+    while (++__i < __n && !adaptive_done(&__a, __samples[__i-1])); \
+    timeit_stats(__samples, __i); \
+})
+
+#define TIMEIT_MULTI(n, setup, stmt) \
+    SAMPLE_MULTI(n, TIMEIT(setup, stmt))
+
+#define TIMEIT_WHILE_MULTI(n, setup, stmt, cond) \
+    SAMPLE_MULTI(n, TIMEIT_WHILE(setup, stmt, cond))
+
+#endif